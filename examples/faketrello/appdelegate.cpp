@@ -5,7 +5,7 @@
 
 AppDelegate::AppDelegate(QObject *parent) : QObject(parent)
 {
-    cardListStore = new QSListModel(this);
+    cardListStore = new QImmutable::VariantListModel(this);
 
 }
 
@@ -85,6 +85,9 @@ void AppDelegate::sync()
     // Otherwise, it won't be able to generate insertion, removal and move patch.
     runner.setKeyField("uuid");
 
+    // A changed column carries the card moves / insertions / removals instead of a new list.
+    runner.setNestedKeyField("cards", "uuid");
+
     QList<QSPatch> patches = runner.compare(cardListStore->storage(),
                                             lists);
 
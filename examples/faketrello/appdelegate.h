@@ -3,7 +3,7 @@
 
 #include <QObject>
 #include <QQmlApplicationEngine>
-#include "qslistmodel.h"
+#include "qimmutablevariantlistmodel.h"
 #include "board.h"
 
 class AppDelegate : public QObject
@@ -37,7 +37,7 @@ private slots:
 
 private:
     QQmlApplicationEngine m_engine;
-    QSListModel* cardListStore;
+    QImmutable::VariantListModel* cardListStore;
 
     // A fake trello board
     Board m_board;
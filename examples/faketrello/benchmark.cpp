@@ -0,0 +1,186 @@
+#include <QtCore>
+#include <algorithm>
+#include "benchmark.h"
+#include "qsdiffrunner.h"
+#include "qimmutablevariantlistmodel.h"
+
+// The cost of one interaction in ns
+class Sample {
+public:
+    qint64 toMapNs;
+    qint64 compareNs;
+    qint64 patchNs;
+    int patches;
+
+    qint64 total() const {
+        return toMapNs + compareNs + patchNs;
+    }
+};
+
+static QJsonObject summarize(const QString& name, const QList<Sample>& samples)
+{
+    QJsonObject res;
+    res["interaction"] = name;
+    res["count"] = samples.size();
+
+    if (samples.isEmpty()) {
+        return res;
+    }
+
+    double toMapNs = 0, compareNs = 0, patchNs = 0, patches = 0;
+    QVector<qint64> totals;
+
+    for (int i = 0 ; i < samples.size() ; i++) {
+        toMapNs += samples.at(i).toMapNs;
+        compareNs += samples.at(i).compareNs;
+        patchNs += samples.at(i).patchNs;
+        patches += samples.at(i).patches;
+        totals << samples.at(i).total();
+    }
+
+    std::sort(totals.begin(), totals.end());
+
+    res["toMapNs"] = toMapNs / samples.size();
+    res["compareNs"] = compareNs / samples.size();
+    res["patchNs"] = patchNs / samples.size();
+    res["patches"] = patches / samples.size();
+    res["medianTotalNs"] = (double) totals.at(totals.size() / 2);
+    res["maxTotalNs"] = (double) totals.last();
+    return res;
+}
+
+Benchmark::Benchmark()
+{
+    listCount = 2000;
+    cardsPerList = 20;
+    interactions = 400;
+    seed = 1;
+    nested = true;
+}
+
+QStringList Benchmark::interactionNames()
+{
+    return QStringList() << "moveCard" << "addCard" << "removeCard" << "moveList";
+}
+
+QJsonObject Benchmark::run()
+{
+    qsrand(seed);
+
+    m_board = Board();
+    m_board.generate(listCount, cardsPerList);
+
+    QImmutable::VariantListModel store;
+
+    QSDiffRunner runner;
+    runner.setKeyField("uuid");
+    if (nested) {
+        runner.setNestedKeyField("cards", "uuid");
+    }
+
+    // The same cycle as AppDelegate::sync()
+    auto sync = [&]() {
+        Sample sample;
+        QElapsedTimer timer;
+        timer.start();
+
+        QVariantList lists = m_board.toMap()["lists"].toList();
+        sample.toMapNs = timer.nsecsElapsed();
+
+        timer.restart();
+        QSPatchSet patches = runner.compare(store.storage(), lists);
+        sample.compareNs = timer.nsecsElapsed();
+
+        sample.patches = patches.size();
+        timer.restart();
+        runner.patch(&store, std::move(patches));
+        sample.patchNs = timer.nsecsElapsed();
+
+        return sample;
+    };
+
+    Sample initial = sync();
+
+    QStringList names = interactionNames();
+    QHash<QString, QList<Sample> > samples;
+    QList<Sample> all;
+
+    for (int i = 0 ; i < interactions ; i++) {
+        QString name = names.at(i % names.size());
+        interact(name);
+        Sample sample = sync();
+        samples[name] << sample;
+        all << sample;
+    }
+
+    QJsonArray results;
+    for (int i = 0 ; i < names.size() ; i++) {
+        results.append(summarize(names.at(i), samples[names.at(i)]));
+    }
+
+    int cards = 0;
+    QList<List> lists = m_board.lists();
+    for (int i = 0 ; i < lists.size() ; i++) {
+        cards += lists.at(i).cards().size();
+    }
+
+    QJsonObject res;
+    res["lists"] = lists.size();
+    res["cards"] = cards;
+    res["interactions"] = interactions;
+    res["seed"] = (double) seed;
+    res["nested"] = nested;
+    res["initialSyncNs"] = (double) initial.total();
+    res["overall"] = summarize("all", all);
+    res["results"] = results;
+    res["consistent"] = store.storage() == m_board.toMap()["lists"].toList();
+
+    return res;
+}
+
+void Benchmark::interact(const QString &name)
+{
+    if (name == "addCard") {
+        List list = randomList(0);
+        m_board.addCard(list.uuid());
+
+    } else if (name == "removeCard") {
+        List list = randomList(1);
+        if (list.cards().size() > 0) {
+            QList<Card> cards = list.cards();
+            m_board.removeCard(list.uuid(), cards.at(qrand() % cards.size()).uuid());
+        }
+
+    } else if (name == "moveCard") {
+        List list = randomList(2);
+        QList<Card> cards = list.cards();
+        if (cards.size() >= 2) {
+            int from = qrand() % cards.size();
+            int to = qrand() % cards.size();
+            m_board.moveCard(list.uuid(), cards.at(from).uuid(), cards.at(to).uuid());
+        }
+
+    } else if (name == "moveList") {
+        QList<List> lists = m_board.lists();
+        if (lists.size() >= 2) {
+            int from = qrand() % lists.size();
+            int to = qrand() % lists.size();
+            m_board.moveList(lists.at(from).uuid(), lists.at(to).uuid());
+        }
+    }
+}
+
+List Benchmark::randomList(int minimumCards) const
+{
+    QList<List> lists = m_board.lists();
+    if (lists.isEmpty()) {
+        return List();
+    }
+
+    // Give up after a few attempts on a board that is almost empty
+    List res = lists.at(qrand() % lists.size());
+    for (int i = 0 ; i < 10 && res.cards().size() < minimumCards ; i++) {
+        res = lists.at(qrand() % lists.size());
+    }
+    return res;
+}
@@ -0,0 +1,39 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QJsonObject>
+#include <QStringList>
+#include "board.h"
+
+// Run scripted interactions on a synthetic board without UI, and measure the
+// Board::toMap() -> QSDiffRunner::compare() -> patch() cycle of each interaction.
+class Benchmark
+{
+public:
+    Benchmark();
+
+    int listCount;
+
+    int cardsPerList;
+
+    int interactions;
+
+    uint seed;
+
+    // Produce sub-patches for the cards of a changed list, as AppDelegate::sync() does
+    bool nested;
+
+    QJsonObject run();
+
+    // The interactions are performed in this order, repeatedly
+    static QStringList interactionNames();
+
+private:
+    void interact(const QString& name);
+
+    List randomList(int minimumCards) const;
+
+    Board m_board;
+};
+
+#endif // BENCHMARK_H
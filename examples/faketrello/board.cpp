@@ -85,6 +85,18 @@ void Board::moveCard(const QString &listUuid, const QString &fromCardUUid, const
     d->lists[index] = list;
 }
 
+void Board::moveList(const QString &fromListUuid, const QString &toListUuid)
+{
+    int from = indexOfList(fromListUuid);
+    int to = indexOfList(toListUuid);
+
+    if (from < 0 || to < 0) {
+        return;
+    }
+
+    d->lists.move(from, to);
+}
+
 int Board::indexOfList(const QString &listUuid)
 {
 
@@ -123,6 +135,22 @@ void Board::failsafeLoad() {
     d->lists << list1 << list2;
 }
 
+void Board::generate(int listCount, int cardsPerList)
+{
+    d->lists.reserve(d->lists.size() + listCount);
+
+    for (int i = 0 ; i < listCount ; i++) {
+        List column = list();
+        QList<Card> cards;
+        cards.reserve(cardsPerList);
+        for (int j = 0 ; j < cardsPerList ; j++) {
+            cards << card();
+        }
+        column.setCards(cards);
+        d->lists << column;
+    }
+}
+
 // NPM: load persisted JSON board, or call failsafeload() above if first run or malformed persistence file.
 // see https://github.com/benlau/qsyncable/issues/2
 void Board::load(const QString& persistFilePath)
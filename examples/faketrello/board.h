@@ -28,6 +28,8 @@ public:
 
     void moveCard(const QString& listUuid,const QString& fromCardUUid, const QString& toCardUuid);
 
+    void moveList(const QString& fromListUuid, const QString& toListUuid);
+
     int indexOfList(const QString& listUuid);
 
     // NPM: Load persisted board from file.
@@ -36,6 +38,9 @@ public:
     // NPM: Load initial board if persistence file missing or malformed.
     void failsafeLoad();
 
+    // Append a synthetic board of listCount lists with cardsPerList cards each
+    void generate(int listCount, int cardsPerList);
+
     QVariantMap toMap() const;
 
 private:
@@ -7,7 +7,8 @@ SOURCES += main.cpp \
     appdelegate.cpp \
     card.cpp \
     list.cpp \
-    board.cpp
+    board.cpp \
+    benchmark.cpp
 
 RESOURCES += qml.qrc
 
@@ -17,13 +18,14 @@ QML_IMPORT_PATH =
 # Default rules for deployment.
 include(deployment.pri)
 
-include(../../qsyncable.pri)
+include(../../qimmutable.pri)
 
 HEADERS += \
     appdelegate.h \
     card.h \
     list.h \
-    board.h
+    board.h \
+    benchmark.h
 
 DISTFILES += \
     README.md
@@ -1,9 +1,72 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QtCore>
 #include "appdelegate.h"
+#include "benchmark.h"
+
+// faketrello --bench [--lists N] [--cards N] [--interactions N] [--seed N] [--flat] [--output file]
+static int runBenchmark(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure the Board::toMap() -> QSDiffRunner::compare() -> patch() cycle "
+                                     "of scripted interactions on a synthetic board. The result is written as JSON.");
+    parser.addHelpOption();
+
+    Benchmark benchmark;
+
+    QCommandLineOption benchOption("bench", "Run the benchmark without UI.");
+    QCommandLineOption listsOption("lists", "No. of lists.", "count", QString::number(benchmark.listCount));
+    QCommandLineOption cardsOption("cards", "No. of cards per list.", "count", QString::number(benchmark.cardsPerList));
+    QCommandLineOption interactionsOption("interactions", "No. of interactions: " + Benchmark::interactionNames().join(","),
+                                          "count", QString::number(benchmark.interactions));
+    QCommandLineOption seedOption("seed", "The random seed.", "seed", QString::number(benchmark.seed));
+    QCommandLineOption flatOption("flat", "Replace the whole card list of a changed list instead of nested patches.");
+    QCommandLineOption outputOption("output", "Write the result to a file instead of stdout.", "file");
+
+    parser.addOption(benchOption);
+    parser.addOption(listsOption);
+    parser.addOption(cardsOption);
+    parser.addOption(interactionsOption);
+    parser.addOption(seedOption);
+    parser.addOption(flatOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    benchmark.listCount = parser.value(listsOption).toInt();
+    benchmark.cardsPerList = parser.value(cardsOption).toInt();
+    benchmark.interactions = parser.value(interactionsOption).toInt();
+    benchmark.seed = parser.value(seedOption).toUInt();
+    benchmark.nested = !parser.isSet(flatOption);
+
+    QJsonObject result = benchmark.run();
+    result["qtVersion"] = QString(qVersion());
+
+    QByteArray json = QJsonDocument(result).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "faketrello: Failed to write" << file.fileName();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return result["consistent"].toBool() ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1 ; i < argc ; i++) {
+        if (qstrcmp(argv[i], "--bench") == 0) {
+            return runBenchmark(argc, argv);
+        }
+    }
+
     QGuiApplication app(argc, argv);
     Q_UNUSED(app);
 
@@ -11,4 +74,3 @@ int main(int argc, char *argv[])
 
     return delegate.run();
 }
-
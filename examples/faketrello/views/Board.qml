@@ -20,7 +20,7 @@ ListView {
         height: parent.height
         listUuid: model.uuid
         title: model.title
-        cards: model.cards
+        listIndex: index
     }
 }
 
@@ -8,7 +8,9 @@ Item {
 
     property var listUuid
     property var title
-    property var cards
+
+    // The row of this list in CardListStore
+    property int listIndex: -1
 
     Rectangle {
         anchors.left: parent.left
@@ -118,9 +120,12 @@ Item {
                 }
             }
 
+            // The card moves / insertions / removals found by AppDelegate::sync() are applied directly
             model: JsonListModel {
                 keyField: "uuid"
-                source: cardList.cards
+                parentModel: CardListStore
+                parentIndex: cardList.listIndex
+                parentField: "cards"
             }
 
             delegate: Card {
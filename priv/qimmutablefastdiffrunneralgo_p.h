@@ -3,187 +3,559 @@
 #include "priv/qsalgotypes_p.h"
 #include "priv/qimmutabletree.h"
 #include "priv/qimmutablecollection.h"
+#include "qimmutablechunkedlist.h"
 #include "qspatch.h"
 #include "qimmutableconvert.h"
+#include "qimmutablepatchable.h"
+#include "qimmutablediffstatistics.h"
+#include "qimmutabletrace.h"
+#include <QElapsedTimer>
+#include <QSet>
+#include <climits>
 
 namespace QImmutable {
 
+// The way a FastDiffRunnerAlgo produced its result
+enum DiffStrategy {
+    // Items are matched by their keys (or identities)
+    KeyedDiff,
+    // Items are compared position by position
+    KeylessDiff,
+    // The whole list is replaced by a Reset patch
+    ResetDiff
+};
+
 template <typename T>
 class FastDiffRunnerAlgo {
 
 public:
 
+    // The progress of a resumable comparison
+    enum Phase {
+        Finished,
+        CheckIdentity,
+        Preprocess,
+        CompareWithoutKey,
+        CheckKeyRange,
+        BuildFromHash,
+        BuildToHash,
+        NextRound,
+        ScanFrom,
+        ScanTo,
+        BuildReset
+    };
+
     FastDiffRunnerAlgo() {
+        offset = 0;
+        partial = false;
+        identityKey = false;
+        sink = 0;
+        batchStarted = false;
+        castSink = 0;
+        batchSink = 0;
+        resetRatio = -1;
+        resetMinimumSize = 100;
+        usedStrategy = KeyedDiff;
+        statistics = 0;
+        phaseStart = 0;
+        traceOffset = -1;
+        phaseConverterCalls = 0;
+        phaseConverterTime = 0;
+
+        reset();
+
+        converter = [](const T& value, int index) {
+            Q_UNUSED(index);
+            return QImmutable::convert(value);
+        };
+    }
+
+    QSPatchSet compare(const Collection<T>& from, const Collection<T>& to) {
+        start(from, to);
+        run(-1);
+        return result();
+    }
+
+    // Start a resumable comparison. Call run() until it returns true, then take the result().
+    // Calling start() again discards the progress of the previous comparison.
+    void start(const Collection<T>& from, const Collection<T>& to) {
+        reset();
+
+        this->from = from;
+        this->to = to;
+        usedStrategy = KeyedDiff;
+
+        if (statistics != 0) {
+            statistics->clear();
+            statistics->fromCount = from.size();
+            statistics->toCount = to.size();
+            statistics->sharedList = from.isSharedWith(to);
+        }
+
+        if (from.isSharedWith(to)) {
+            return;
+        }
+
+        if (wrapper.hasKey()) {
+            phase = Preprocess;
+        } else if (identityKey && wrapper.hasIdentity()) {
+            phase = CheckIdentity;
+        } else {
+            startCompareWithoutKey();
+        }
+    }
+
+    // Continue the comparison for budget ms. A negative budget runs until finished.
+    // Returns true if it is finished.
+    bool run(int budget) {
+        TraceSpan span("FastDiffRunnerAlgo::run");
+        QElapsedTimer timer;
+        timer.start();
+        int steps = 0;
+
+        // The time between two runs is not counted
+        phaseStart = 0;
+        traceOffset = Trace::isEnabled() ? Trace::now() : -1;
+        phaseConverterCalls = 0;
+        phaseConverterTime = 0;
+        bool observed = statistics != 0 || traceOffset >= 0;
+
+        while (phase != Finished) {
+            Phase current = phase;
+            step();
+
+            if (observed && (phase == Finished || stepOf(phase) != stepOf(current))) {
+                recordPhase(current, timer.nsecsElapsed());
+            }
+
+            // Checking the clock on every step is too expensive
+            if (budget >= 0 && ++steps % 64 == 0 && timer.elapsed() >= budget) {
+                break;
+            }
+        }
+
+        if (observed && phase != Finished) {
+            recordPhase(phase, timer.nsecsElapsed());
+        }
+
+        if (phase == Finished && sink != 0) {
+            flush();
+        }
+
+        if (statistics != 0) {
+            statistics->totalTime += timer.nsecsElapsed();
+        }
+
+        return phase == Finished;
+    }
+
+    bool isFinished() const {
+        return phase == Finished;
+    }
+
+    QSPatchSet result() const {
+        QSPatchSet res = patches;
+        if (updatePatches.size() > 0) {
+            res.append(updatePatches);
+        }
+        return res;
+    }
+
+    // Discard the state of the previous comparison. The compared lists are released,
+    // but the tables keep their capacity, so an algo reused by a model doesn't reallocate
+    // them on every comparison.
+    void reset() {
+        endBatch();
+
+        from = Collection<T>();
+        to = Collection<T>();
+        itemF = T();
+        itemT = T();
+
+        patches.clear();
+        updatePatches.clear();
+        hash.clear();
+
         insertStart = -1;
         removeStart = -1;
+        removing = 0;
 
         skipped = 0;
         indexT = -1;
         indexF = -1;
+        keyF.clear();
+        keyT.clear();
 
-        removing = 0;
+        pendingMovePatch.clear();
+        tree.clear();
 
-        converter = [](const T& value, int index) {
-            Q_UNUSED(index);
-            return QImmutable::convert(value);
-        };
+        useIdentity = false;
+        identities.clear();
+
+        slotsF.clear();
+        slotsT.clear();
+        rangeMin = rangeMax = 0;
+
+        matched = 0;
+        breaks = 0;
+        lastPosF = -1;
+        resetData.clear();
+
+        cursor = 0;
+        phase = Finished;
     }
 
-    QSPatchSet compare(const Collection<T>& from, const Collection<T>& to) {
+    // Compare two versions of a ChunkedList. The chunks shared at the beginning and the end are skipped.
+    QSPatchSet compare(const ChunkedList<T>& from, const ChunkedList<T>& to) {
         if (from.isSharedWith(to)) {
             return QSPatchSet();
         }
-        patches.clear();
-        updatePatches.clear();
 
-        this->from = from;
-        this->to = to;
+        int fromChunks = from.chunkCount();
+        int toChunks = to.chunkCount();
+        int head = 0;
+        int tail = 0;
+        int prefix = 0;
+        int suffix = 0;
+
+        while (head < fromChunks && head < toChunks &&
+               from.chunk(head).isSharedWith(to.chunk(head))) {
+            prefix += from.chunk(head).size();
+            head++;
+        }
 
-        if (!wrapper.hasKey()) {
-            return compareWithoutKey(from, to);
+        while (tail < fromChunks - head && tail < toChunks - head &&
+               from.chunk(fromChunks - tail - 1).isSharedWith(to.chunk(toChunks - tail - 1))) {
+            suffix += from.chunk(fromChunks - tail - 1).size();
+            tail++;
         }
 
-        // Compare the list, until it found moved component.
-        preprocess(from, to);
+        QList<T> fromList = from.mid(prefix, from.size() - prefix - suffix);
+        QList<T> toList = to.mid(prefix, to.size() - prefix - suffix);
 
-        if (skipped >= from.size() &&
-            skipped >= to.size()) {
-            // Nothing moved
-            return combine();
+        offset = prefix;
+        partial = prefix > 0 || suffix > 0;
+        QSPatchSet res = compare(fromList, toList);
+        offset = 0;
+        partial = false;
+
+        if (prefix > 0) {
+            for (int i = 0 ; i < res.size() ; i++) {
+                QSPatch& patch = res[i];
+                patch.setFrom(patch.from() + prefix);
+                patch.setTo(patch.to() + prefix);
+            }
         }
 
-        buildHashTable();
-        //@TODO - Discover duplicated key. It should fallback to use compareWithoutKey
+        return res;
+    }
 
-        indexF = skipped;
-        indexT = skipped;
-        int fromSize = from.size();
-        int toSize = to.size();
+    void setWrapper(Item<T> value) {
+        wrapper = value;
+    }
 
-        QSAlgoTypes::State state;
+    std::function<QVariantMap(T,int)> converter;
 
-        while (indexF < fromSize || indexT < toSize) {
+    // List fields to be compared into a sub-QSPatchSet, and their key fields
+    QHash<QString, QString> nestedKeyFields;
 
-            keyF.clear();
+    // Match items without a key by their identity (shared d-pointer). Items
+    // are moved, inserted and removed as a whole, and a modified item is replaced.
+    // It falls back to the key-less comparison if an item appears twice in a list.
+    bool identityKey;
 
-            while (indexF < fromSize) {
-                // Process until it found an item that remain in origianl position (neither removd / moved).
-                itemF = from[indexF];
-                keyF = wrapper.key(itemF);
+    // If it is set, the patches are applied to the sink as soon as they are found instead of
+    // being collected for result(). A patch is held until the next one can't be merged into it,
+    // and the update patches are applied after all the structural changes, so every index
+    // is valid at the time it is applied. The result() will be empty.
+    Patchable* sink;
 
-                state = hash[keyF]; // It mush obtain the key value
+    // If the estimated no. of inserted, removed and moved items exceeds resetRatio times
+    // the size of the list, the result is a single Reset patch that carries the new list.
+    // A view handles a reset much faster than thousands of fine-grained changes.
+    // A negative value disables it (default).
+    qreal resetRatio;
 
-                if (state.posT < 0) {
-                    markItemAtFromList(QSAlgoTypes::Remove, state);
-                    indexF++;
-                } else if (state.isMoved) {
-                    markItemAtFromList(QSAlgoTypes::Move, state);
-                    indexF++;
-                } else {
-                    markItemAtFromList(QSAlgoTypes::NoMove, state);
-                    // The item remain in original position.
-                    break;
-                }
-            }
+    // A list with fewer items is never reset
+    int resetMinimumSize;
 
-            if (indexF >= fromSize && indexT < toSize) {
-                // The rest in "to" list is new items
-                appendPatch(createInsertPatch(indexT, toSize - 1, to), false);
-                return combine();
+    // The strategy chosen by the last comparison
+    DiffStrategy strategy() const {
+        return usedStrategy;
+    }
+
+    // If it is set, it is cleared by start() and filled with the cost of the comparison.
+    // The apply time is only available with a sink.
+    DiffStatistics* statistics;
+
+private:
+
+    // Process a unit of work of the current phase
+    void step() {
+        switch (phase) {
+        case CheckIdentity:
+            checkIdentity();
+            break;
+        case Preprocess:
+            preprocess();
+            break;
+        case CompareWithoutKey:
+            compareWithoutKey();
+            break;
+        case CheckKeyRange:
+            checkKeyRange();
+            break;
+        case BuildFromHash:
+        case BuildToHash:
+            buildHashTable();
+            break;
+        case NextRound:
+            if (indexF < from.size() || indexT < to.size()) {
+                keyF.clear();
+                phase = ScanFrom;
+            } else {
+                QSAlgoTypes::State dummy;
+                markItemAtToList(QSAlgoTypes::NoMove, dummy);
+                markItemAtFromList(QSAlgoTypes::NoMove, dummy);
+                phase = Finished;
             }
+            break;
+        case ScanFrom:
+            scanFrom();
+            break;
+        case ScanTo:
+            scanTo();
+            break;
+        case BuildReset:
+            buildReset();
+            break;
+        default:
+            break;
+        }
+    }
 
-            while (indexT < toSize ) {
-                itemT = to[indexT];
-                keyT = wrapper.key(itemT);
-                state = hash[keyT];
-
-                if (state.posF < 0) {
-                    // new item
-                    markItemAtToList(QSAlgoTypes::Insert, state);
-                    indexT++;
-                } else {
-                    if (keyT != keyF) {
-                        markItemAtToList(QSAlgoTypes::Move, state);
-                        indexT++;
-                    } else {
-                        markItemAtToList(QSAlgoTypes::NoMove, state);
-                        indexT++;
-                        indexF++;
-                        break;
-                    }
-                }
+    void compareWithoutKey() {
+        int i = cursor++;
+
+        if (i >= qMax(from.size(), to.size())) {
+            phase = Finished;
+        } else if (i >= from.size()) {
+            appendPatch(QSPatch(QSPatch::Insert, i, i, 1, convert(to[i], i + offset)), false);
+        } else if (i >= to.size() ) {
+            appendPatch(QSPatch(QSPatch::Remove, i, i, 1), false);
+        } else {
+            QVariantMap diff = fastDiff(i, i);
+            if (diff.size()) {
+                appendPatch(QSPatch(QSPatch::Update, i, i, 1, diff), false);
             }
         }
-        QSAlgoTypes::State dummy;
+    }
+
+    // The phases are grouped as the steps of the statistics and the trace
+    enum Step {
+        PrefixScanStep,
+        HashBuildStep,
+        WalkStep
+    };
+
+    static Step stepOf(Phase phase) {
+        switch (phase) {
+        case Preprocess:
+            return PrefixScanStep;
+        case CheckIdentity:
+        case CheckKeyRange:
+        case BuildFromHash:
+        case BuildToHash:
+            return HashBuildStep;
+        default:
+            return WalkStep;
+        }
+    }
+
+    // Add the time since the last record to the step of the phase. The result is counted when it is finished.
+    void recordPhase(Phase current, qint64 now) {
+        qint64 elapsed = now - phaseStart;
+        Step group = stepOf(current);
+
+        if (traceOffset >= 0) {
+            static const char* names[] = {
+                "FastDiffRunnerAlgo::prefixScan",
+                "FastDiffRunnerAlgo::hashBuild",
+                "FastDiffRunnerAlgo::walk"
+            };
+            Trace::record(names[group], traceOffset + phaseStart, traceOffset + now,
+                          phaseConverterCalls, phaseConverterTime);
+            phaseConverterCalls = 0;
+            phaseConverterTime = 0;
+        }
+
+        phaseStart = now;
+
+        if (statistics == 0) {
+            return;
+        }
 
-        markItemAtToList(QSAlgoTypes::NoMove, dummy);
-        markItemAtFromList(QSAlgoTypes::NoMove, dummy);
+        if (group == PrefixScanStep) {
+            statistics->prefixScanTime += elapsed;
+        } else if (group == HashBuildStep) {
+            statistics->hashBuildTime += elapsed;
+        } else {
+            statistics->walkTime += elapsed;
+        }
 
-        return combine();
+        if (phase == Finished && sink == 0) {
+            statistics->countPatches(patches);
+            statistics->countPatches(updatePatches);
+        }
     }
 
-    void setWrapper(Item<T> value) {
-        wrapper = value;
+    QVariantMap convert(const T& item, int index) {
+        if (statistics != 0) {
+            statistics->converterCalls++;
+        }
+        if (traceOffset < 0) {
+            return converter(item, index);
+        }
+
+        // Reported on the span of the phase
+        qint64 start = Trace::now();
+        QVariantMap res = converter(item, index);
+        phaseConverterCalls++;
+        phaseConverterTime += Trace::now() - start;
+        return res;
     }
 
-    std::function<QVariantMap(T,int)> converter;
+    void countProbes(int count) {
+        if (statistics != 0) {
+            statistics->hashProbes += count;
+        }
+    }
 
-private:
+    void countTreeOperations(int count) {
+        if (statistics != 0) {
+            statistics->treeOperations += count;
+        }
+    }
 
-    // Combine all the processing patches into a single list. It will clear the processing result too.
-    QSPatchSet combine() {
-        if (updatePatches.size() > 0) {
-            patches.append(updatePatches);
+    void startCompareWithoutKey() {
+        usedStrategy = KeylessDiff;
+        cursor = 0;
+
+        if (isResetEnabled() && exceedsResetRatio(estimateKeylessChanges())) {
+            startReset();
+        } else {
+            phase = CompareWithoutKey;
         }
+    }
 
-        return patches;
+    // A partial comparison of a ChunkedList can't replace the whole list
+    bool isResetEnabled() const {
+        return resetRatio >= 0 && !partial && qMax(from.size(), to.size()) >= resetMinimumSize;
     }
 
-    QList<QSPatch> compareWithoutKey(const Collection<T>& from, const Collection<T>& to) {
-        QList<QSPatch> patches;
+    bool exceedsResetRatio(int changes) const {
+        return changes > resetRatio * qMax(from.size(), to.size());
+    }
 
-        int max = qMax(from.size(), to.size());
+    // Estimate the no. of changed rows of a key-less comparison by sampling the common part
+    int estimateKeylessChanges() {
+        int common = qMin(from.size(), to.size());
+        int samples = qMin(common, 32);
+        int changed = 0;
 
-        for (int i = 0 ; i < max ; i++) {
-            if (i >= from.size()) {
-                patches << QSPatch(QSPatch::Insert, i, i, 1, converter(to[i], i));
-            } else if (i >= to.size() ) {
-                patches << QSPatch(QSPatch::Remove, i, i, 1);
-            } else {
-                QVariantMap diff = fastDiff(i, i);
-                if (diff.size()) {
-                    patches << QSPatch(QSPatch::Update, i, i, 1, diff);
-                }
+        for (int i = 0 ; i < samples ; i++) {
+            int index = (int) ((qint64) i * common / samples);
+            if (fastDiff(index, index).size() > 0) {
+                changed++;
             }
         }
 
-        return patches;
+        int res = qAbs(from.size() - to.size());
+        if (samples > 0) {
+            res += (int) ((qint64) changed * common / samples);
+        }
+        return res;
     }
 
-    // Preprocess the list, stop until the key is different. It will also handle common pattern (like append to end , remove from end)
-    int preprocess(const Collection<T>& from, const Collection<T>& to) {
-        int index = 0;
-        int min = qMin(from.size(), to.size());
-        T f;
-        T t;
+    // Nothing is applied to the sink before this point, so the found patches could be discarded
+    void startReset() {
+        usedStrategy = ResetDiff;
+        patches.clear();
+        updatePatches.clear();
+        resetData.clear();
+        resetData.reserve(to.size());
+        cursor = 0;
+        phase = BuildReset;
+    }
 
-        for (index = 0 ; index < min ;index++) {
+    void buildReset() {
+        int i = cursor++;
 
-            f = from[index];
-            t = to[index];
+        if (i >= to.size()) {
+            patches << QSPatch(QSPatch::Reset, 0, from.size() - 1, from.size(), std::move(resetData));
+            resetData = QVariantList();
+            phase = Finished;
+            return;
+        }
 
-            if (wrapper.isShared(f, t)) {
-                continue;
-            }
+        resetData << convert(to[i], i);
+    }
 
-            if (wrapper.key(f) != wrapper.key(t)) {
-                break;
+    QString keyOf(const T& item) {
+        if (statistics != 0) {
+            statistics->keyCalls++;
+        }
+        return useIdentity ? wrapper.identity(item) : wrapper.key(item);
+    }
+
+    // Verify that every item in a list has an unique identity
+    void checkIdentity() {
+        int i = cursor++;
+
+        if (i == 0 || i == from.size()) {
+            identities.clear();
+            identities.reserve(i == 0 ? from.size() : to.size());
+        }
+
+        if (i >= from.size() + to.size()) {
+            identities.clear();
+            useIdentity = true;
+            cursor = 0;
+            phase = Preprocess;
+            return;
+        }
+
+        QString key = wrapper.identity(i < from.size() ? from[i] : to[i - from.size()]);
+
+        if (identities.contains(key)) {
+            identities.clear();
+            startCompareWithoutKey();
+            return;
+        }
+        identities.insert(key);
+    }
+
+    // Preprocess the list, stop until the key is different. It will also handle common pattern (like append to end , remove from end)
+    void preprocess() {
+        int index = cursor;
+
+        if (index < qMin(from.size(), to.size())) {
+            T f = from[index];
+            T t = to[index];
+
+            if (wrapper.isShared(f, t)) {
+                cursor++;
+                return;
             }
 
-            QVariantMap diff = fastDiff(index, index);
-            if (diff.size()) {
-                //@TODO reserve in block size
-                updatePatches << QSPatch::createUpdate(index, diff);
+            if (keyOf(f) == keyOf(t)) {
+                QVariantMap diff = fastDiff(index, index);
+                if (diff.size()) {
+                    //@TODO reserve in block size
+                    updatePatches << QSPatch::createUpdate(index, diff);
+                }
+                cursor++;
+                return;
             }
         }
 
@@ -191,33 +563,132 @@ private:
             // Special case: append to end
             skipped = to.size();
             appendPatch(createInsertPatch(index,to.size() - 1,to));
-            return to.size();
-        }
-
-        if (to.size() == index && from.size() - index> 0) {
+        } else if (to.size() == index && from.size() - index> 0) {
             // Special case: removed from end
             appendPatch(QSPatch::createRemove(index, from.size() - 1));
             skipped = from.size();
-            return from.size();
+        } else {
+            skipped = index;
+        }
+
+        if (statistics != 0) {
+            statistics->skipped = index;
+            statistics->appendToEnd = from.size() == index && to.size() > index;
+            statistics->removeFromEnd = to.size() == index && from.size() > index;
         }
 
-        skipped = index;
+        if (skipped >= from.size() &&
+            skipped >= to.size()) {
+            // Nothing moved
+            phase = Finished;
+            return;
+        }
 
-        return index;
+        cursor = 0;
+
+        if (useIdentity) {
+            useHashTable();
+        } else {
+            phase = CheckKeyRange;
+        }
     }
 
-    void buildHashTable() {
+    // Use a dense table if the keys of the remaining items are integers within a compact range
+    void checkKeyRange() {
+        int i = cursor++;
+        int fromCount = from.size() - skipped;
+        int toCount = to.size() - skipped;
+        int key;
+
+        if (i == 0) {
+            slotsF.clear();
+            slotsT.clear();
+            slotsF.reserve(fromCount);
+            slotsT.reserve(toCount);
+            rangeMin = INT_MAX;
+            rangeMax = INT_MIN;
+        }
+
+        if (i >= fromCount + toCount) {
+            if (!QSAlgoTypes::isDenseRange(rangeMin, rangeMax, qMax(fromCount, toCount))) {
+                useHashTable();
+                return;
+            }
+
+            hash.setRange(rangeMin, rangeMax);
+            for (int j = 0 ; j < slotsF.size() ; j++) {
+                slotsF[j] = hash.slot(slotsF[j]);
+            }
+            for (int j = 0 ; j < slotsT.size() ; j++) {
+                slotsT[j] = hash.slot(slotsT[j]);
+            }
+
+            cursor = skipped;
+            phase = BuildFromHash;
+            return;
+        }
+
+        bool isFrom = i < fromCount;
+        T item = isFrom ? from[skipped + i] : to[skipped + i - fromCount];
+
+        if (statistics != 0) {
+            statistics->keyCalls++;
+        }
+
+        if (!wrapper.intKey(item, key)) {
+            useHashTable();
+            return;
+        }
+
+        rangeMin = qMin(rangeMin, key);
+        rangeMax = qMax(rangeMax, key);
+
+        // The range only grows. Sparse keys stop here instead of paying for intKey() and key() on every item.
+        if (!QSAlgoTypes::isDenseRange(rangeMin, rangeMax, qMax(fromCount, toCount))) {
+            useHashTable();
+            return;
+        }
+
+        if (isFrom) {
+            slotsF << key;
+        } else {
+            slotsT << key;
+        }
+    }
+
+    void useHashTable() {
+        slotsF.clear();
+        slotsT.clear();
         hash.reserve( (qMax(to.size(), from.size()) - skipped) * 2 + 100);
+        cursor = skipped;
+        phase = BuildFromHash;
+    }
+
+    // The key of the item at index i of the "from" or "to" list
+    QSAlgoTypes::Key keyAt(const Collection<T>& list, const QVector<int>& slots, int i) {
+        QSAlgoTypes::Key key;
+        if (hash.isDense()) {
+            key.slot = slots.at(i - skipped);
+        } else {
+            key.string = keyOf(list[i]);
+        }
+        return key;
+    }
 
+    void buildHashTable() {
         QSAlgoTypes::State state;
-        T item;
-        QString key;
-        int fromSize = from.size();
-        int toSize = to.size();
-
-        for (int i = skipped; i < fromSize ; i++) {
-            item = from[i];
-            key = wrapper.key(item);
+        QSAlgoTypes::Key key;
+        int i = cursor++;
+
+        if (phase == BuildFromHash) {
+            if (i >= from.size()) {
+                cursor = skipped;
+                phase = BuildToHash;
+                return;
+            }
+
+            key = keyAt(from, slotsF, i);
+            countProbes(2);
             if (hash.contains(key)) {
                 qWarning() << "QSFastDiffRunner.compare() - Duplicated or missing key.";
                 //@TODO fail back to burte force mode
@@ -225,14 +696,34 @@ private:
             state.posF = i;
             state.posT = -1;
             hash.insert(key, state);
-        }
+        } else {
+            if (i >= to.size()) {
+                // Every break in the order of the matched items is counted as a move
+                int changes = (from.size() - skipped - matched) + (to.size() - skipped - matched) + breaks;
+                if (isResetEnabled() && exceedsResetRatio(changes)) {
+                    startReset();
+                    return;
+                }
+
+                indexF = skipped;
+                indexT = skipped;
+                phase = NextRound;
+                return;
+            }
 
-        for (int i = skipped; i < toSize ; i++) {
-            item = to[i];
-            key = wrapper.key(item);
+            key = keyAt(to, slotsT, i);
+            countProbes(2);
 
             if (hash.contains(key)) {
-                hash[key].posT = i;
+                QSAlgoTypes::State& found = hash[key];
+                found.posT = i;
+                if (found.posF >= 0) {
+                    matched++;
+                    if (lastPosF >= 0 && found.posF != lastPosF + 1) {
+                        breaks++;
+                    }
+                    lastPosF = found.posF;
+                }
             } else {
                 state.posF = -1;
                 state.posT = i;
@@ -241,6 +732,64 @@ private:
         }
     }
 
+    // Process until it found an item that remain in origianl position (neither removd / moved).
+    void scanFrom() {
+        if (indexF >= from.size()) {
+            if (indexT < to.size()) {
+                // The rest in "to" list is new items
+                appendPatch(createInsertPatch(indexT, to.size() - 1, to), false);
+                phase = Finished;
+            } else {
+                phase = ScanTo;
+            }
+            return;
+        }
+
+        itemF = from[indexF];
+        keyF = keyAt(from, slotsF, indexF);
+
+        QSAlgoTypes::State state = hash[keyF]; // It mush obtain the key value
+        countProbes(1);
+
+        if (state.posT < 0) {
+            markItemAtFromList(QSAlgoTypes::Remove, state);
+            indexF++;
+        } else if (state.isMoved) {
+            markItemAtFromList(QSAlgoTypes::Move, state);
+            indexF++;
+        } else {
+            markItemAtFromList(QSAlgoTypes::NoMove, state);
+            // The item remain in original position.
+            phase = ScanTo;
+        }
+    }
+
+    void scanTo() {
+        if (indexT >= to.size()) {
+            phase = NextRound;
+            return;
+        }
+
+        itemT = to[indexT];
+        keyT = keyAt(to, slotsT, indexT);
+        QSAlgoTypes::State state = hash[keyT];
+        countProbes(1);
+
+        if (state.posF < 0) {
+            // new item
+            markItemAtToList(QSAlgoTypes::Insert, state);
+            indexT++;
+        } else if (keyT != keyF) {
+            markItemAtToList(QSAlgoTypes::Move, state);
+            indexT++;
+        } else {
+            markItemAtToList(QSAlgoTypes::NoMove, state);
+            indexT++;
+            indexF++;
+            phase = NextRound;
+        }
+    }
+
     // Mark an item for insert, remove, move
     void markItemAtFromList(QSAlgoTypes::Type type, QSAlgoTypes::State &state) {
         if (removeStart >= 0 && type != QSAlgoTypes::Remove) {
@@ -265,6 +814,7 @@ private:
 
         state.posF = indexF;
         hash[keyF] = state;
+        countProbes(1);
     }
 
     void markItemAtToList(QSAlgoTypes::Type type, QSAlgoTypes::State& state) {
@@ -297,6 +847,7 @@ private:
 
             state.isMoved = true;
             hash[keyT] = state;
+            countProbes(1);
         }
 
         if (type != QSAlgoTypes::Move && !pendingMovePatch.isNull()) {
@@ -317,10 +868,10 @@ private:
         QVariantList list;
         list.reserve(count);
         for (int i = from ; i < from + count;i++) {
-            list << converter(source[i], i);
+            list << convert(source[i], i + offset);
         }
 
-        return QSPatch(QSPatch::Insert, from, to, count, list);
+        return QSPatch(QSPatch::Insert, from, to, count, std::move(list));
     }
 
     void appendPatch(const QSPatch& value, bool merge = true) {
@@ -334,10 +885,93 @@ private:
         }
 
         if (!merged) {
+            if (sink != 0 && patches.size() > 0) {
+                // The pending patch can't be merged anymore
+                apply(patches.takeLast());
+            }
             patches << value;
         }
     }
 
+    // Apply the pending patch and the update patches to the sink
+    void flush() {
+        QSPatchSet pending = patches;
+        pending.append(updatePatches);
+        patches.clear();
+        updatePatches.clear();
+
+        if (offset > 0) {
+            for (int i = 0 ; i < pending.size() ; i++) {
+                pending[i] = shifted(pending.at(i));
+            }
+        }
+
+        // The clock is only read if the statistics are collected
+        QElapsedTimer timer;
+        if (statistics != 0) {
+            statistics->countPatches(pending);
+            timer.start();
+        }
+
+        beginBatch();
+        applyPatches(sink, std::move(pending));
+        endBatch();
+
+        if (statistics != 0) {
+            statistics->applyTime += timer.nsecsElapsed();
+        }
+    }
+
+    void apply(QSPatch patch) {
+        QElapsedTimer timer;
+        if (statistics != 0) {
+            statistics->countPatch(patch);
+            timer.start();
+        }
+
+        beginBatch();
+        if (offset > 0) {
+            patch = shifted(patch);
+        }
+        applyPatch(sink, sinkAsBatch(), std::move(patch));
+
+        if (statistics != 0) {
+            statistics->applyTime += timer.nsecsElapsed();
+        }
+    }
+
+    // The indexes are relative to the compared lists
+    QSPatch shifted(QSPatch patch) const {
+        patch.setFrom(patch.from() + offset);
+        patch.setTo(patch.to() + offset);
+        return patch;
+    }
+
+    // The patches applied to a BatchPatchable sink in a comparison are a single batch
+    void beginBatch() {
+        BatchPatchable* batch = sinkAsBatch();
+        if (batch && !batchStarted) {
+            batchStarted = true;
+            batch->beginBatch();
+        }
+    }
+
+    void endBatch() {
+        BatchPatchable* batch = sinkAsBatch();
+        if (batch && batchStarted) {
+            batchStarted = false;
+            batch->endBatch();
+        }
+    }
+
+    BatchPatchable* sinkAsBatch() {
+        if (castSink != sink) {
+            castSink = sink;
+            batchSink = dynamic_cast<BatchPatchable*>(sink);
+        }
+        return batchSink;
+    }
+
     void appendMovePatch(QSAlgoTypes::MoveOp& moveOp) {
         QSPatch patch(QSPatch::Move, moveOp.from, moveOp.to, moveOp.count);
 
@@ -345,6 +979,7 @@ private:
 
         TreeNode* node = tree.insert(moveOp.posF,moveOp.count);
         offset = tree.countLessThan(node);
+        countTreeOperations(2);
 
         if (offset > 0) {
             patch.setFrom(patch.from() - offset);
@@ -364,6 +999,7 @@ private:
     void updateTree() {
         while (tree.root() != 0 && tree.min() <= indexF) {
             tree.remove(tree.min());
+            countTreeOperations(1);
         }
     }
 
@@ -375,7 +1011,14 @@ private:
         if (wrapper.isShared(itemF, itemT)) {
             return res;
         }
-        res = QImmutable::diff(converter(itemF, f), converter(itemT, t));
+        if (statistics == 0) {
+            return QImmutable::diff(convert(itemF, f + offset), convert(itemT, t + offset), nestedKeyFields);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        res = QImmutable::diff(convert(itemF, f + offset), convert(itemT, t + offset), nestedKeyFields);
+        statistics->fieldDiffTime += timer.nsecsElapsed();
         return res;
     }
 
@@ -391,8 +1034,31 @@ private:
     // Update patches
     QList<QSPatch> updatePatches;
 
-    // Hash table
-    QHash<QString, QSAlgoTypes::State> hash;
+    // Hash table, or a dense table for compact integer keys
+    QSAlgoTypes::StateTable hash;
+
+    // The dense table slots of the items after "skipped"
+    QVector<int> slotsF, slotsT;
+
+    int rangeMin, rangeMax;
+
+    // The no. of items in both lists, and the no. of breaks in their order. They estimate the size of the changes.
+    int matched, breaks, lastPosF;
+
+    // The converted items of a Reset patch
+    QVariantList resetData;
+
+    DiffStrategy usedStrategy;
+
+    // The time the current phase is started in a run()
+    qint64 phaseStart;
+
+    // The trace time of the start of run(). -1 if tracing is disabled.
+    qint64 traceOffset;
+
+    // The converter calls of the phase being traced
+    int phaseConverterCalls;
+    qint64 phaseConverterTime;
 
     // The start position of remove block
     int removeStart;
@@ -406,17 +1072,40 @@ private:
     // A no. of item could be skipped found preprocess().
     int skipped;
 
-    QString keyF,keyT;
+    QSAlgoTypes::Key keyF,keyT;
 
     int indexF,indexT;
 
     T itemF,itemT;
 
+    // The position of the compared lists in the whole list. It is passed to the converter.
+    int offset;
+
+    // True if only the middle part of a ChunkedList is compared
+    bool partial;
+
+    Phase phase;
+
+    // The position processed by the current phase
+    int cursor;
+
     /* Move Patches */
     QSAlgoTypes::MoveOp pendingMovePatch;
 
     // Tree of move patch
     Tree tree;
+
+    // True if beginBatch() is called on the sink
+    bool batchStarted;
+
+    // The sink as a BatchPatchable. It is cast again only if another sink is assigned.
+    Patchable* castSink;
+    BatchPatchable* batchSink;
+
+    // True if identityKey is enabled and the identities are unique
+    bool useIdentity;
+
+    QSet<QString> identities;
 };
 
 }
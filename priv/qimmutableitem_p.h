@@ -4,6 +4,7 @@
 #include <QJSValue>
 #include <QJSValueIterator>
 #include "qimmutablefunctions.h"
+#include "priv/qsalgotypes_p.h"
 
 namespace QImmutable {
 
@@ -45,6 +46,32 @@ public:
         return ret;
     }
 
+    // Get the key as an integer. Returns false if key() doesn't return an int.
+    bool intKey(const T& value, int& ret) {
+        const QMetaObject meta = T::staticMetaObject;
+        int index = meta.indexOfMethod("key()");
+        if (index < 0) {
+            return false;
+        }
+
+        QMetaMethod method = meta.method(index);
+        if (method.returnType() != QVariant::Int) {
+            return false;
+        }
+
+        method.invokeOnGadget((void*) &value, Q_RETURN_ARG(int, ret));
+        return true;
+    }
+
+    inline bool hasIdentity() const {
+        return true;
+    }
+
+    // An implicit key of an item. Shared items (a copy of the same d-pointer) have the same identity.
+    inline QString identity(const T& value) const {
+        return QString::fromLatin1((const char*) &value, sizeof(T));
+    }
+
 };
 
 template<>
@@ -73,6 +100,22 @@ public:
         return res;
     }
 
+    bool intKey(const QVariantMap& object, int& ret) {
+        if (keyField.isNull()) {
+            return false;
+        }
+
+        return QSAlgoTypes::toIntKey(object[keyField], ret);
+    }
+
+    inline bool hasIdentity() const {
+        return true;
+    }
+
+    inline QString identity(const QVariantMap& value) const {
+        return QString::fromLatin1((const char*) &value, sizeof(QVariantMap));
+    }
+
     QString keyField;
 
 };
@@ -108,6 +151,28 @@ public:
         return res;
     }
 
+    bool intKey(const QJSValue& object, int& ret) {
+        if (keyField.isNull()) {
+            return false;
+        }
+
+        QJSValue value = object.property(keyField);
+        if (!value.isNumber()) {
+            return false;
+        }
+        return QSAlgoTypes::toIntKey(value.toNumber(), ret);
+    }
+
+    // QJSValue doesn't expose a hashable identity. strictlyEquals() could only compare a pair of values.
+    inline bool hasIdentity() const {
+        return false;
+    }
+
+    inline QString identity(const QJSValue& value) const {
+        Q_UNUSED(value);
+        return QString();
+    }
+
     QString keyField;
 
 };
@@ -0,0 +1,99 @@
+#pragma once
+#include <QVariantList>
+#include "qspatch.h"
+#include "qimmutablepatchable.h"
+
+namespace QImmutable {
+
+/// Apply patches to a plain QVariantList
+class ListPatcher : public Patchable {
+public:
+    ListPatcher(QVariantList& list) : list(list) {
+    }
+
+    void insert(int index, const QVariantList &value) {
+        if (index < 0 || index > list.size()) {
+            return;
+        }
+        for (int i = 0 ; i < value.size() ; i++) {
+            list.insert(index + i, value.at(i));
+        }
+    }
+
+    void move(int from, int to, int count) {
+        if (count <= 0 || from == to || from < 0 || to < 0 ||
+            from + count > list.size() || to + count > list.size()) {
+            return;
+        }
+        QVariantList block = list.mid(from, count);
+        list.erase(list.begin() + from, list.begin() + from + count);
+        for (int i = 0 ; i < block.size() ; i++) {
+            list.insert(to + i, block.at(i));
+        }
+    }
+
+    void remove(int i, int count) {
+        if (count < 1 || i < 0 || i + count > list.size()) {
+            return;
+        }
+        list.erase(list.begin() + i, list.begin() + i + count);
+    }
+
+    void set(int index, QVariantMap dict) {
+        if (index < 0 || index > list.size()) {
+            return;
+        } else if (index == list.size()) {
+            list.append(dict);
+            return;
+        }
+
+        QVariantMap item = list.at(index).toMap();
+        QMapIterator<QString, QVariant> iter(dict);
+        while (iter.hasNext()) {
+            iter.next();
+            item[iter.key()] = value(item.value(iter.key()), iter.value());
+        }
+        list[index] = item;
+    }
+
+    // Returns the new value of a field. A QSPatchSet is applied on the current list.
+    static QVariant value(const QVariant& current, const QVariant& change) {
+        if (change.userType() != qMetaTypeId<QSPatchSet>()) {
+            return change;
+        }
+
+        QVariantList nested = current.toList();
+        ListPatcher patcher(nested);
+        QSPatchSet patches = change.value<QSPatchSet>();
+        for (int i = 0 ; i < patches.size() ; i++) {
+            patcher.patch(patches.at(i));
+        }
+        return nested;
+    }
+
+    void patch(const QSPatch& patch) {
+        switch (patch.type()) {
+        case QSPatch::Insert:
+            insert(patch.from(), patch.data());
+            break;
+        case QSPatch::Remove:
+            remove(patch.from(), patch.count());
+            break;
+        case QSPatch::Move:
+            move(patch.from(), patch.to(), patch.count());
+            break;
+        case QSPatch::Update:
+            set(patch.from(), patch.data().size() > 0 ? patch.data().at(0).toMap() : QVariantMap());
+            break;
+        case QSPatch::Reset:
+            list = patch.data();
+            break;
+        default:
+            break;
+        }
+    }
+
+    QVariantList& list;
+};
+
+}
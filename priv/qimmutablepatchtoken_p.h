@@ -0,0 +1,67 @@
+#pragma once
+#include <QVariantMap>
+#include "qimmutableconvert.h"
+#include "priv/qimmutableitem_p.h"
+
+namespace QImmutable {
+
+/// A row tracked while composing patches
+class PatchToken {
+public:
+    PatchToken(int origin = -1) : origin(origin), serial(-1) {
+    }
+
+    // The position in the original list. -1 for an inserted row
+    int origin;
+
+    // The serial no. of an inserted row
+    int serial;
+
+    // The content of an inserted row, or the accumulated changes of an original row
+    QVariantMap data;
+};
+
+template<>
+inline QVariantMap convert(const PatchToken& token) {
+    return token.data;
+}
+
+template<>
+class Item<PatchToken> {
+public:
+    inline bool isShared(const PatchToken& v1, const PatchToken& v2) const {
+        return v1.origin >= 0 &&
+               v1.origin == v2.origin &&
+               v1.data.isEmpty() &&
+               v2.data.isEmpty();
+    }
+
+    bool hasKey() {
+        return true;
+    }
+
+    QString key(const PatchToken& token) {
+        if (token.origin >= 0) {
+            return QString::number(token.origin);
+        }
+        return QString("+%1").arg(token.serial);
+    }
+
+    bool intKey(const PatchToken& token, int& ret) {
+        if (token.origin < 0) {
+            return false;
+        }
+        ret = token.origin;
+        return true;
+    }
+
+    inline bool hasIdentity() const {
+        return true;
+    }
+
+    QString identity(const PatchToken& token) {
+        return key(token);
+    }
+};
+
+}
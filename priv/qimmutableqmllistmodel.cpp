@@ -2,9 +2,37 @@
 
 using namespace QImmutable;
 
+/*! \property QImmutable::QmlListModel::compareBudget
+
+    The time budget (in ms) of comparing a new source per event loop turn. If the comparison
+    could not be finished within the budget, it continues on the next turn, and the patches are
+    applied after it is finished. So a huge JavaScript array could be synced without dropping frames.
+
+    The default value is -1, which compares the source immediately in setSource().
+
+    The source array must not be modified in place while comparing. If a newer source is set,
+    the comparison is restarted with it.
+ */
+
+/*! \property QImmutable::QmlListModel::resetThreshold
+
+    If the estimated no. of inserted, removed and moved rows exceeds resetThreshold times the size of
+    the source, the model is reset instead of receiving the fine-grained changes. For example, 0.5
+    resets the model if more than half of the rows are changed. It only applies to a source with
+    at least 100 items.
+
+    The default value is -1, which disables it.
+ */
+
+/*! \property QImmutable::QmlListModel::lastStrategy
+
+    The strategy chosen to apply the last source: "keyed", "keyless" or "reset".
+ */
+
 QmlListModel::QmlListModel(QObject *parent) : VariantListModel(parent)
 {
-
+    m_compareBudget = -1;
+    m_comparing = false;
 }
 
 QString QmlListModel::keyField() const
@@ -25,21 +53,35 @@ QJSValue QmlListModel::source() const
 
 void QmlListModel::setSource(const QJSValue &source)
 {
-    if (m_source.strictlyEquals(source)) {
+    TraceSpan span("QmlListModel::setSource");
+
+    if (m_comparing ? m_pendingSource.strictlyEquals(source) : m_source.strictlyEquals(source)) {
         return;
     }
 
-    FastDiffRunner<QJSValue> runner;
-    QImmutable::FastDiffRunnerAlgo<QJSValue> algo;
+    if (capturing()) {
+        capture(source.toVariant().toList());
+    }
+
     Item<QJSValue> wrapper;
     wrapper.keyField = m_keyField;
-    algo.setWrapper(wrapper);
+    m_algo.setWrapper(wrapper);
 
-    QList<QSPatch> patches = algo.compare(m_source, source);
-    runner.patch(this, patches);
-    m_source = source;
+    // The model is not modified until the comparison is finished, so it is safe to restart from m_source
+    m_pendingSource = source;
+    m_algo.statistics = diffStatisticsEnabled() ? &m_statistics : 0;
+    m_algo.start(m_source, source);
 
-    emit sourceChanged();
+    if (m_algo.run(m_compareBudget)) {
+        apply();
+        return;
+    }
+
+    if (!m_comparing) {
+        m_comparing = true;
+        emit comparingChanged();
+        QMetaObject::invokeMethod(this, "resume", Qt::QueuedConnection);
+    }
 }
 
 QStringList QmlListModel::fields() const
@@ -53,3 +95,86 @@ void QmlListModel::setFields(const QStringList &fields)
     emit fieldsChanged();
     setRoleNames(fields);
 }
+
+int QmlListModel::compareBudget() const
+{
+    return m_compareBudget;
+}
+
+void QmlListModel::setCompareBudget(int compareBudget)
+{
+    m_compareBudget = compareBudget;
+    emit compareBudgetChanged();
+}
+
+bool QmlListModel::comparing() const
+{
+    return m_comparing;
+}
+
+qreal QmlListModel::resetThreshold() const
+{
+    return m_algo.resetRatio;
+}
+
+void QmlListModel::setResetThreshold(qreal resetThreshold)
+{
+    m_algo.resetRatio = resetThreshold;
+    emit resetThresholdChanged();
+}
+
+QString QmlListModel::lastStrategy() const
+{
+    switch (m_algo.strategy()) {
+    case KeylessDiff:
+        return "keyless";
+    case ResetDiff:
+        return "reset";
+    default:
+        return "keyed";
+    }
+}
+
+void QmlListModel::resume()
+{
+    TraceSpan span("QmlListModel::resume");
+
+    if (!m_comparing || m_algo.isFinished()) {
+        // Finished by a newer source
+        return;
+    }
+
+    if (m_algo.run(m_compareBudget)) {
+        apply();
+    } else {
+        QMetaObject::invokeMethod(this, "resume", Qt::QueuedConnection);
+    }
+}
+
+void QmlListModel::apply()
+{
+    FastDiffRunner<QJSValue> runner;
+    QSPatchSet patches = m_algo.result();
+    m_algo.reset();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    runner.patch(this, patches);
+
+    if (m_algo.statistics != 0) {
+        m_statistics.applyTime = timer.nsecsElapsed();
+        m_statistics.totalTime += m_statistics.applyTime;
+        m_algo.statistics = 0;
+        setDiffStatistics(m_statistics);
+    }
+    m_source = m_pendingSource;
+    m_pendingSource = QJSValue();
+
+    if (m_comparing) {
+        m_comparing = false;
+        emit comparingChanged();
+    }
+
+    emit sourceChanged();
+}
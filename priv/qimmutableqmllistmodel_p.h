@@ -14,6 +14,10 @@ namespace QImmutable {
         Q_PROPERTY(QString keyField READ keyField WRITE setKeyField NOTIFY keyFieldChanged)
         Q_PROPERTY(QJSValue source READ source WRITE setSource NOTIFY sourceChanged)
         Q_PROPERTY(QStringList fields READ fields WRITE setFields NOTIFY fieldsChanged)
+        Q_PROPERTY(int compareBudget READ compareBudget WRITE setCompareBudget NOTIFY compareBudgetChanged)
+        Q_PROPERTY(bool comparing READ comparing NOTIFY comparingChanged)
+        Q_PROPERTY(qreal resetThreshold READ resetThreshold WRITE setResetThreshold NOTIFY resetThresholdChanged)
+        Q_PROPERTY(QString lastStrategy READ lastStrategy NOTIFY sourceChanged)
     public:
         explicit QmlListModel(QObject *parent = nullptr);
 
@@ -26,17 +30,44 @@ namespace QImmutable {
         QStringList fields() const;
         void setFields(const QStringList &fields);
 
+        int compareBudget() const;
+        void setCompareBudget(int compareBudget);
+
+        bool comparing() const;
+
+        qreal resetThreshold() const;
+        void setResetThreshold(qreal resetThreshold);
+
+        QString lastStrategy() const;
+
     signals:
         void keyFieldChanged();
         void sourceChanged();
         void fieldsChanged();
+        void compareBudgetChanged();
+        void comparingChanged();
+        void resetThresholdChanged();
 
     public slots:
+
+    private slots:
+        void resume();
+
     private:
+        void apply();
+
         QString m_keyField;
         QJSValue m_source;
         QStringList m_fields;
 
+        int m_compareBudget;
+
+        // The source being compared with m_source
+        QJSValue m_pendingSource;
+        bool m_comparing;
+        FastDiffRunnerAlgo<QJSValue> m_algo;
+        DiffStatistics m_statistics;
+
     };
 
 }
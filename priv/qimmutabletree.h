@@ -14,6 +14,9 @@ public:
 
     bool isNull() const;
 
+    // Remove all the nodes
+    void clear();
+
     int min() const;
 
     int max() const;
@@ -1,4 +1,10 @@
 #pragma once
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QVariant>
+#include <climits>
+#include <cmath>
 
 namespace QSAlgoTypes {
 
@@ -61,4 +67,128 @@ namespace QSAlgoTypes {
         int count;
     };
 
+    // The key of an item. In a dense table, it is the slot of the item instead of a string.
+    class Key {
+    public:
+        inline Key() : slot(-1) {
+        }
+
+        inline void clear() {
+            string.clear();
+            slot = -1;
+        }
+
+        inline bool operator==(const Key& other) const {
+            return slot == other.slot && string == other.string;
+        }
+
+        inline bool operator!=(const Key& other) const {
+            return !(*this == other);
+        }
+
+        QString string;
+
+        int slot;
+    };
+
+    // True if the range of integer keys is close to the no. of items, so a flat array is cheaper than a hash table
+    inline bool isDenseRange(int min, int max, int count) {
+        return (qint64) max - min < (qint64) count * 2 + 64;
+    }
+
+    // A number as an int key. Numbers from JSON / Javascript are doubles, only an integral one within the range of int is accepted.
+    inline bool toIntKey(double value, int& ret) {
+        if (!(value >= INT_MIN && value <= INT_MAX) || value != std::floor(value)) {
+            return false;
+        }
+        ret = (int) value;
+        return true;
+    }
+
+    // A key field as an int key. LongLong, UInt and ULongLong values are accepted if they fit in an int.
+    inline bool toIntKey(const QVariant& value, int& ret) {
+        switch (value.type()) {
+        case QVariant::Int:
+            ret = value.toInt();
+            return true;
+        case QVariant::UInt:
+        case QVariant::ULongLong:
+            if (value.toULongLong() > (quint64) INT_MAX) {
+                return false;
+            }
+            ret = (int) value.toULongLong();
+            return true;
+        case QVariant::LongLong:
+            if (value.toLongLong() < INT_MIN || value.toLongLong() > INT_MAX) {
+                return false;
+            }
+            ret = (int) value.toLongLong();
+            return true;
+        case QVariant::Double:
+            return toIntKey(value.toDouble(), ret);
+        default:
+            return false;
+        }
+    }
+
+    // The states of the items. Keys in a compact integer range are addressed directly without hashing.
+    class StateTable {
+    public:
+        inline StateTable() : dense(false), min(0) {
+        }
+
+        inline bool isDense() const {
+            return dense;
+        }
+
+        // Switch to direct addressing for the keys between min and max
+        inline void setRange(int min, int max) {
+            table.fill(State(), max - min + 1);
+            this->min = min;
+            dense = true;
+        }
+
+        // The slot of an integer key in the dense table
+        inline int slot(int key) const {
+            return key - min;
+        }
+
+        inline void reserve(int size) {
+            hash.reserve(size);
+        }
+
+        // Remove all the states. The buckets of the hash table and the capacity of the dense table are kept for reuse.
+        inline void clear() {
+            QHash<QString, State>::iterator iter = hash.begin();
+            while (iter != hash.end()) {
+                iter = hash.erase(iter);
+            }
+            table.clear();
+            dense = false;
+            min = 0;
+        }
+
+        inline bool contains(const Key& key) const {
+            if (dense) {
+                const State& state = table.at(key.slot);
+                return state.posF >= 0 || state.posT >= 0;
+            }
+            return hash.contains(key.string);
+        }
+
+        inline void insert(const Key& key, const State& state) {
+            (*this)[key] = state;
+        }
+
+        inline State& operator[](const Key& key) {
+            return dense ? table[key.slot] : hash[key.string];
+        }
+
+    private:
+        QHash<QString, State> hash;
+        QVector<State> table;
+        bool dense;
+        int min;
+    };
+
 }
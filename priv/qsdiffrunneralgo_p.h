@@ -2,9 +2,11 @@
 #define QSDIFFRUNNERALGO_H
 
 #include <QString>
+#include <QElapsedTimer>
 #include "priv/qsalgotypes_p.h"
 #include "qspatch.h"
 #include "qimmutabletree.h"
+#include "qimmutablediffstatistics.h"
 
 class QSDiffRunnerAlgo {
 
@@ -17,21 +19,36 @@ public:
 
     void setKeyField(const QString &keyField);
 
+    void setNestedKeyFields(const QHash<QString, QString>& nestedKeyFields);
+
+    // If it is set, it is filled with the cost of each compare()
+    void setStatistics(QImmutable::DiffStatistics* statistics);
+
 private:
 
+    QSPatchSet run(const QVariantList& from, const QVariantList& to);
+
+    void countProbes(int count) const;
+
 
     // Combine all the processing patches into a single list. It will clear the processing result too.
     QSPatchSet combine();
 
-    static QList<QSPatch> compareWithoutKey(const QVariantList& from, const QVariantList& to);
+    QList<QSPatch> compareWithoutKey(const QVariantList& from, const QVariantList& to) const;
 
-    static QVariantMap compareMap(const QVariantMap& prev, const QVariantMap& current);
+    QVariantMap compareMap(const QVariantMap& prev, const QVariantMap& current) const;
 
     // Preprocess the list, stop until the key is different. It will also handle common pattern (like append to end , remove from end)
     int preprocess(const QVariantList& from, const QVariantList& to);
 
     void buildHashTable();
 
+    // Use a dense table if the keys of the remaining items are integers within a compact range
+    bool checkKeyRange();
+
+    // The key of the item at index i of the "from" or "to" list
+    QSAlgoTypes::Key keyAt(const QVariantList& list, const QVector<int>& slots, int i) const;
+
     // Mark an item for insert, remove, move
     void markItemAtFromList(QSAlgoTypes::Type type, QSAlgoTypes::State &state);
 
@@ -57,8 +74,11 @@ private:
     // Update patches
     QList<QSPatch> updatePatches;
 
-    // Hash table
-    QHash<QString, QSAlgoTypes::State> hash;
+    // Hash table, or a dense table for compact integer keys
+    QSAlgoTypes::StateTable hash;
+
+    // The dense table slots of the items after "skipped"
+    QVector<int> slotsF, slotsT;
 
     // The start position of remove block
     int removeStart;
@@ -72,7 +92,7 @@ private:
     // A no. of item could be skipped found preprocess().
     int skipped;
 
-    QString keyF,keyT;
+    QSAlgoTypes::Key keyF,keyT;
 
     int indexF,indexT;
 
@@ -86,6 +106,13 @@ private:
 
     QString m_keyField;
 
+    QHash<QString, QString> m_nestedKeyFields;
+
+    QImmutable::DiffStatistics* m_statistics;
+
+    // The time since compare() is started
+    QElapsedTimer m_clock;
+
 
 };
 
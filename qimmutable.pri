@@ -22,7 +22,21 @@ HEADERS += \
     $$PWD/priv/qimmutabletreenode.h \
     $$PWD/qimmutableconvert.h \
     $$PWD/qimmutablefastdiffrunner.h \
-    $$PWD/qimmutablepatchable.h
+    $$PWD/qimmutablepatchable.h \
+    $$PWD/qimmutablediffstatistics.h \
+    $$PWD/qimmutabletrace.h \
+    $$PWD/qimmutablecapture.h \
+    $$PWD/qimmutableaggregator.h \
+    $$PWD/qimmutablecompose.h \
+    $$PWD/priv/qimmutablepatchtoken_p.h \
+    $$PWD/qimmutablechunkedlist.h \
+    $$PWD/qimmutablesynchub.h \
+    $$PWD/qimmutablesnapshot.h \
+    $$PWD/qimmutablejournal.h \
+    $$PWD/priv/qimmutablelistpatcher_p.h \
+    $$PWD/qimmutablepatchcodec.h \
+    $$PWD/qimmutablereplicator.h \
+    $$PWD/qimmutableincrementalpatcher.h
 
 SOURCES += \
     $$PWD/qsdiffrunner.cpp \
@@ -37,4 +51,15 @@ SOURCES += \
     $$PWD/qimmutablefunctions.cpp \
     $$PWD/qimmutablevariantlistmodel.cpp \
     $$PWD/priv/qimmutableqmllistmodel.cpp \
-    $$PWD/qimmutableconvert.cpp
+    $$PWD/qimmutableconvert.cpp \
+    $$PWD/qimmutableaggregator.cpp \
+    $$PWD/qimmutablecompose.cpp \
+    $$PWD/qimmutablesnapshot.cpp \
+    $$PWD/qimmutablejournal.cpp \
+    $$PWD/qimmutablepatchcodec.cpp \
+    $$PWD/qimmutablereplicator.cpp \
+    $$PWD/qimmutableincrementalpatcher.cpp \
+    $$PWD/qimmutablepatchable.cpp \
+    $$PWD/qimmutablediffstatistics.cpp \
+    $$PWD/qimmutabletrace.cpp \
+    $$PWD/qimmutablecapture.cpp
@@ -0,0 +1,389 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutableaggregator.h"
+
+using namespace QImmutable;
+
+/*! \class QImmutable::Aggregator
+    \inmodule QImmutable
+
+Aggregator maintains the count, sum, min and max of the rows of a list per group,
+and the no. of sections (a run of adjacent rows with the same group).
+It implements the Patchable interface, so it could be patched by the same patches applied to a list model:
+
+\code
+    QSPatchSet patches = runner.compare(model.storage(), list);
+    runner.patch(&model, patches);
+    runner.patch(&aggregator, patches);
+\endcode
+
+Only the rows touched by a patch are visited, so the cost of a sync is O(k) instead of
+recomputing from VariantListModel::storage(). The groups remember their rows in the groups model,
+so writing a modified group is O(1). The exception is the removal of a group, which shifts the rows
+of the groups after it in O(groups). The result is available as a list model by the groups property
+with fields: group, count, sum, min, max and sections.
+
+The groupField and valueField should be set before any patch is applied.
+ */
+
+Aggregator::Aggregator(QObject *parent) : QObject(parent)
+{
+    m_sectionCount = 0;
+    m_model = new VariantListModel(this);
+    m_model->setRoleNames(QStringList() << "group" << "count" << "sum" << "min" << "max" << "sections");
+}
+
+QString Aggregator::groupField() const
+{
+    return m_groupField;
+}
+
+void Aggregator::setGroupField(const QString &groupField)
+{
+    m_groupField = groupField;
+    emit groupFieldChanged();
+}
+
+QString Aggregator::valueField() const
+{
+    return m_valueField;
+}
+
+void Aggregator::setValueField(const QString &valueField)
+{
+    m_valueField = valueField;
+    emit valueFieldChanged();
+}
+
+/*! \property QImmutable::Aggregator::groups
+
+    A list model of the groups in the order of their first appearance.
+ */
+
+QObject *Aggregator::groups() const
+{
+    return m_model;
+}
+
+/*! \fn int QImmutable::Aggregator::count() const
+
+    Returns no. of rows aggregated.
+ */
+
+int Aggregator::count() const
+{
+    return m_rows.size();
+}
+
+/*! \fn int QImmutable::Aggregator::sectionCount() const
+
+    Returns no. of section boundaries, i.e. the no. of runs of adjacent rows with the same group.
+ */
+
+int Aggregator::sectionCount() const
+{
+    return m_sectionCount;
+}
+
+/*! \fn void QImmutable::Aggregator::reset(const QVariantList &rows)
+
+    Discard the current result and rebuild it from rows.
+ */
+
+void Aggregator::reset(const QVariantList &rows)
+{
+    m_rows.clear();
+    m_groups.clear();
+    m_keys.clear();
+    m_dirty.clear();
+    m_dirtySet.clear();
+    m_sectionCount = 0;
+
+    m_rows.reserve(rows.size());
+
+    for (int i = 0 ; i < rows.size() ; i++) {
+        Row row = createRow(rows.at(i).toMap());
+        m_rows.append(row);
+        addRow(row);
+    }
+
+    countSections(0, m_rows.size() - 1, 1);
+
+    // Groups are marked in the order of their first appearance
+    m_keys = m_dirty;
+    m_dirty.clear();
+    m_dirtySet.clear();
+
+    QVariantList storage;
+    for (int i = 0 ; i < m_keys.size(); i++) {
+        Group& group = m_groups[m_keys.at(i)];
+        group.row = i;
+        storage << toMap(group);
+    }
+    m_model->setStorage(storage);
+
+    emit changed();
+}
+
+void Aggregator::insert(int index, const QVariantList &value)
+{
+    if (index < 0 || index > m_rows.size() || value.isEmpty()) {
+        return;
+    }
+
+    countSections(index, index, -1);
+
+    m_rows.insert(index, value.size(), Row());
+
+    for (int i = 0 ; i < value.size(); i++) {
+        Row row = createRow(value.at(i).toMap());
+        m_rows[index + i] = row;
+        addRow(row);
+    }
+
+    countSections(index, index + value.size(), 1);
+    flush();
+}
+
+void Aggregator::move(int from, int to, int count)
+{
+    if (count <= 0 ||
+        from == to ||
+        from < 0 ||
+        to < 0 ||
+        from + count > m_rows.size() ||
+        to + count > m_rows.size()) {
+        return;
+    }
+
+    int first = qMin(from, to);
+    int last = qMax(from, to) + count;
+
+    countSections(first, last, -1);
+
+    QVector<Row> block = m_rows.mid(from, count);
+    m_rows.remove(from, count);
+    for (int i = 0 ; i < count ; i++) {
+        m_rows.insert(to + i, block.at(i));
+    }
+
+    countSections(first, last, 1);
+    flush();
+}
+
+void Aggregator::remove(int i, int count)
+{
+    if (count < 1 || i < 0 || i + count > m_rows.size()) {
+        return;
+    }
+
+    countSections(i, i + count, -1);
+
+    for (int j = 0 ; j < count ; j++) {
+        removeRow(m_rows.at(i + j));
+    }
+    m_rows.remove(i, count);
+
+    countSections(i, i, 1);
+    flush();
+}
+
+void Aggregator::set(int index, QVariantMap dict)
+{
+    if (index < 0 || index > m_rows.size()) {
+        return;
+    }
+
+    if (index == m_rows.size()) {
+        insert(index, QVariantList() << dict);
+        return;
+    }
+
+    bool groupChanged = !m_groupField.isEmpty() && dict.contains(m_groupField);
+    bool valueChanged = !m_valueField.isEmpty() && dict.contains(m_valueField);
+
+    if (!groupChanged && !valueChanged) {
+        return;
+    }
+
+    if (groupChanged) {
+        countSections(index, index + 1, -1);
+    }
+
+    Row row = m_rows.at(index);
+    removeRow(row);
+
+    if (groupChanged) {
+        row.group = dict.value(m_groupField);
+        row.key = row.group.toString();
+    }
+
+    if (valueChanged) {
+        setValue(row, dict.value(m_valueField));
+    }
+
+    m_rows[index] = row;
+    addRow(row);
+
+    if (groupChanged) {
+        countSections(index, index + 1, 1);
+    }
+
+    flush();
+}
+
+/*! \fn QVariantMap QImmutable::Aggregator::group(const QVariant &name) const
+
+    Returns the aggregated result of a group. If the group does not exist, an empty map is returned.
+ */
+
+QVariantMap Aggregator::group(const QVariant &name) const
+{
+    QString key = name.toString();
+
+    if (!m_groups.contains(key)) {
+        return QVariantMap();
+    }
+
+    return toMap(m_groups[key]);
+}
+
+Aggregator::Row Aggregator::createRow(const QVariantMap &map) const
+{
+    Row row;
+    if (!m_groupField.isEmpty()) {
+        row.group = map.value(m_groupField);
+        row.key = row.group.toString();
+    }
+
+    if (!m_valueField.isEmpty()) {
+        setValue(row, map.value(m_valueField));
+    }
+
+    return row;
+}
+
+void Aggregator::setValue(Aggregator::Row &row, const QVariant &value) const
+{
+    bool ok = false;
+    row.value = value.isValid() ? value.toDouble(&ok) : 0;
+    row.hasValue = ok;
+}
+
+void Aggregator::addRow(const Aggregator::Row &row)
+{
+    if (!m_groups.contains(row.key)) {
+        Group group;
+        group.name = row.group;
+        m_groups[row.key] = group;
+    }
+
+    Group& group = m_groups[row.key];
+    group.count++;
+
+    if (row.hasValue) {
+        group.sum += row.value;
+        group.values[row.value]++;
+    }
+
+    markDirty(row.key);
+}
+
+void Aggregator::removeRow(const Aggregator::Row &row)
+{
+    Group& group = m_groups[row.key];
+    group.count--;
+
+    if (row.hasValue) {
+        group.sum -= row.value;
+        QMap<double,int>::iterator iter = group.values.find(row.value);
+        if (iter != group.values.end() && --iter.value() <= 0) {
+            group.values.erase(iter);
+        }
+    }
+
+    markDirty(row.key);
+}
+
+bool Aggregator::isSectionStart(int index) const
+{
+    return index == 0 || m_rows.at(index - 1).key != m_rows.at(index).key;
+}
+
+void Aggregator::countSections(int first, int last, int delta)
+{
+    first = qMax(first, 0);
+    last = qMin(last, m_rows.size() - 1);
+
+    for (int i = first ; i <= last ; i++) {
+        if (!isSectionStart(i)) {
+            continue;
+        }
+
+        const QString& key = m_rows.at(i).key;
+        m_groups[key].sections += delta;
+        m_sectionCount += delta;
+
+        markDirty(key);
+    }
+}
+
+void Aggregator::flush()
+{
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+
+    Patchable* sink = m_model;
+
+    for (int i = 0 ; i < m_dirty.size(); i++) {
+        QString key = m_dirty.at(i);
+        Group& group = m_groups[key];
+        int index = group.row;
+
+        if (group.count <= 0) {
+            m_groups.remove(key);
+            if (index >= 0) {
+                m_keys.removeAt(index);
+                for (int j = index ; j < m_keys.size() ; j++) {
+                    m_groups[m_keys.at(j)].row = j;
+                }
+                sink->remove(index);
+            }
+        } else if (index < 0) {
+            group.row = m_keys.size();
+            m_keys << key;
+            sink->insert(group.row, QVariantList() << toMap(group));
+        } else {
+            sink->set(index, toMap(group));
+        }
+    }
+
+    m_dirty.clear();
+    m_dirtySet.clear();
+    emit changed();
+}
+
+void Aggregator::markDirty(const QString &key)
+{
+    if (!m_dirtySet.contains(key)) {
+        m_dirtySet.insert(key);
+        m_dirty << key;
+    }
+}
+
+QVariantMap Aggregator::toMap(const Aggregator::Group &group) const
+{
+    QVariantMap map;
+    map["group"] = group.name;
+    map["count"] = group.count;
+    map["sum"] = group.sum;
+    map["min"] = group.values.isEmpty() ? QVariant() : QVariant(group.values.firstKey());
+    map["max"] = group.values.isEmpty() ? QVariant() : QVariant(group.values.lastKey());
+    map["sections"] = group.sections;
+    return map;
+}
@@ -0,0 +1,128 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QVector>
+#include <QStringList>
+#include "qimmutablepatchable.h"
+#include "qimmutablevariantlistmodel.h"
+
+namespace QImmutable {
+
+/// Keeps grouped count / sum / min / max of a list up to date from the patches applied on it.
+class Aggregator : public QObject, public Patchable
+{
+    Q_OBJECT
+    Q_PROPERTY(QString groupField READ groupField WRITE setGroupField NOTIFY groupFieldChanged)
+    Q_PROPERTY(QString valueField READ valueField WRITE setValueField NOTIFY valueFieldChanged)
+    Q_PROPERTY(QObject* groups READ groups CONSTANT)
+    Q_PROPERTY(int count READ count NOTIFY changed)
+    Q_PROPERTY(int sectionCount READ sectionCount NOTIFY changed)
+
+public:
+    explicit Aggregator(QObject *parent = 0);
+
+    QString groupField() const;
+    void setGroupField(const QString &groupField);
+
+    QString valueField() const;
+    void setValueField(const QString &valueField);
+
+    QObject* groups() const;
+
+    int count() const;
+
+    int sectionCount() const;
+
+    // Rebuild the aggregation from a full list (e.g VariantListModel::storage())
+    void reset(const QVariantList& rows);
+
+    virtual void insert(int index, const QVariantList &value);
+
+    virtual void move(int from, int to, int count);
+
+    virtual void remove(int i , int count = 1);
+
+    virtual void set(int index, QVariantMap dict);
+
+public slots:
+
+    QVariantMap group(const QVariant& name) const;
+
+signals:
+    void groupFieldChanged();
+    void valueFieldChanged();
+    void changed();
+
+private:
+    class Row {
+    public:
+        Row() : value(0), hasValue(false) {
+        }
+
+        QVariant group;
+        QString key;
+        double value;
+        bool hasValue;
+    };
+
+    class Group {
+    public:
+        Group() : count(0), sum(0), sections(0), row(-1) {
+        }
+
+        QVariant name;
+        int count;
+        double sum;
+        // Multiset of values for min / max
+        QMap<double, int> values;
+        int sections;
+        // The row in m_model. -1 if it is not written yet
+        int row;
+    };
+
+    Row createRow(const QVariantMap& map) const;
+
+    void setValue(Row& row, const QVariant& value) const;
+
+    void addRow(const Row& row);
+
+    void removeRow(const Row& row);
+
+    bool isSectionStart(int index) const;
+
+    // Add / Remove the sections started within first and last to the counter
+    void countSections(int first, int last, int delta);
+
+    // Write the modified groups to the groups model
+    void flush();
+
+    void markDirty(const QString& key);
+
+    QVariantMap toMap(const Group& group) const;
+
+    QString m_groupField;
+    QString m_valueField;
+
+    QVector<Row> m_rows;
+    QHash<QString, Group> m_groups;
+
+    // The order of groups in m_model
+    QStringList m_keys;
+    QStringList m_dirty;
+    QSet<QString> m_dirtySet;
+
+    int m_sectionCount;
+
+    VariantListModel* m_model;
+};
+
+}
@@ -0,0 +1,163 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablecapture.h"
+
+using namespace QImmutable;
+
+static const quint32 CaptureMagic = 0x51494d43; // "QIMC"
+static const quint32 CaptureVersion = 1;
+
+/*! \class QImmutable::CaptureWriter
+    \inmodule QImmutable
+
+CaptureWriter records every source set on a model with a timestamp. The file could be attached
+to a bug report and replayed by the replay tool in tests/replay against any engine configuration.
+
+ListModel, ImmutableListModel and JsonListModel write to a CaptureWriter if their captureFile
+property is set.
+
+\sa CaptureReader
+ */
+
+CaptureWriter::CaptureWriter()
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        qWarning() << "CaptureWriter: Failed to open" << fileName;
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    m_stream << CaptureMagic << CaptureVersion;
+    m_clock.start();
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    m_stream.setDevice(0);
+    m_file.close();
+}
+
+bool CaptureWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString CaptureWriter::fileName() const
+{
+    return m_file.fileName();
+}
+
+void CaptureWriter::write(const QVariantList &source)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    m_stream << (qint64) m_clock.elapsed() << m_encoder.encodeSnapshot(source);
+
+    // A capture is kept even if the process is crashed
+    m_file.flush();
+}
+
+/*! \class QImmutable::CaptureReader
+    \inmodule QImmutable
+
+CaptureReader reads the frames written by CaptureWriter.
+
+\sa CaptureWriter
+ */
+
+CaptureReader::CaptureReader()
+{
+}
+
+bool CaptureReader::open(const QString &fileName)
+{
+    m_file.close();
+    m_file.setFileName(fileName);
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "CaptureReader: Failed to open" << fileName;
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    m_stream >> magic >> version;
+
+    if (m_stream.status() != QDataStream::Ok || magic != CaptureMagic || version > CaptureVersion) {
+        qWarning() << "CaptureReader: Invalid capture file" << fileName;
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool CaptureReader::next(CaptureFrame &frame)
+{
+    if (!m_file.isOpen() || m_stream.atEnd()) {
+        return false;
+    }
+
+    qint64 timestamp;
+    QByteArray snapshot;
+    m_stream >> timestamp >> snapshot;
+
+    if (m_stream.status() != QDataStream::Ok) {
+        qWarning() << "CaptureReader: Truncated frame";
+        return false;
+    }
+
+    QSPatchSet patches;
+    QVariantList source;
+    if (m_decoder.decode(snapshot, patches, source) != PatchDecoder::Snapshot) {
+        qWarning() << "CaptureReader: Malformed frame";
+        return false;
+    }
+
+    frame.timestamp = timestamp;
+    frame.source = source;
+    return true;
+}
+
+QList<CaptureFrame> CaptureReader::load(const QString &fileName)
+{
+    QList<CaptureFrame> res;
+    CaptureReader reader;
+
+    if (!reader.open(fileName)) {
+        return res;
+    }
+
+    CaptureFrame frame;
+    while (reader.next(frame)) {
+        res << frame;
+    }
+
+    return res;
+}
@@ -0,0 +1,83 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include "qimmutablepatchcodec.h"
+
+namespace QImmutable {
+
+/// A source recorded by CaptureWriter
+class CaptureFrame {
+public:
+    CaptureFrame() : timestamp(0) {
+    }
+
+    // The time since the capture is started in ms
+    qint64 timestamp;
+
+    QVariantList source;
+};
+
+/// Record the sources set on a model to a file, so a real workload could be replayed later.
+/*
+ Every source is written as a snapshot of PatchEncoder, so the field names are not repeated
+ for every item.
+
+ Example:
+
+    model.setCaptureFile("/tmp/model.capture");
+
+ */
+class CaptureWriter {
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    bool open(const QString& fileName);
+
+    void close();
+
+    bool isOpen() const;
+
+    QString fileName() const;
+
+    void write(const QVariantList& source);
+
+private:
+    Q_DISABLE_COPY(CaptureWriter)
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    PatchEncoder m_encoder;
+};
+
+/// Read the frames written by CaptureWriter
+class CaptureReader {
+public:
+    CaptureReader();
+
+    bool open(const QString& fileName);
+
+    // Read the next frame. Returns false at the end of file or on a malformed frame.
+    bool next(CaptureFrame& frame);
+
+    // Read all the frames of a file
+    static QList<CaptureFrame> load(const QString& fileName);
+
+private:
+    Q_DISABLE_COPY(CaptureReader)
+
+    QFile m_file;
+    QDataStream m_stream;
+    PatchDecoder m_decoder;
+};
+
+}
@@ -0,0 +1,203 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+#include <QList>
+#include <QVector>
+
+namespace QImmutable {
+
+/// A persistent list that stores items in implicitly shared chunks.
+/*
+ Copying a ChunkedList only copies the chunk table. Modifying an item detaches
+ the chunk holding it, the other chunks remain shared with the previous version.
+ FastDiffRunner skips the chunks shared between two versions.
+ */
+template <typename T>
+class ChunkedList {
+public:
+    typedef QVector<T> Chunk;
+
+    explicit ChunkedList(int chunkSize = 256) : m_chunkSize(qMax(chunkSize, 1)) {
+    }
+
+    explicit ChunkedList(const QList<T>& list, int chunkSize = 256) : m_chunkSize(qMax(chunkSize, 1)) {
+        m_chunks.reserve(list.size() / m_chunkSize + 1);
+        m_ends.reserve(list.size() / m_chunkSize + 1);
+
+        for (int i = 0 ; i < list.size() ; i += m_chunkSize) {
+            int count = qMin(m_chunkSize, list.size() - i);
+            Chunk chunk;
+            chunk.reserve(count);
+            for (int j = 0 ; j < count ; j++) {
+                chunk.append(list.at(i + j));
+            }
+            m_chunks.append(chunk);
+            m_ends.append(i + count);
+        }
+    }
+
+    int size() const {
+        return m_ends.isEmpty() ? 0 : m_ends.last();
+    }
+
+    bool isEmpty() const {
+        return size() == 0;
+    }
+
+    const T& at(int index) const {
+        int c = chunkIndexOf(index);
+        return m_chunks.at(c).at(index - chunkStart(c));
+    }
+
+    const T& operator[](int index) const {
+        return at(index);
+    }
+
+    T get(int index) const {
+        return at(index);
+    }
+
+    // Replace the item at index. Only the chunk holding it is detached.
+    void replace(int index, const T& value) {
+        int c = chunkIndexOf(index);
+        m_chunks[c][index - chunkStart(c)] = value;
+    }
+
+    void insert(int index, const T& value) {
+        if (m_chunks.isEmpty()) {
+            m_chunks.append(Chunk());
+            m_ends.append(0);
+        }
+
+        int c = index >= size() ? m_chunks.size() - 1 : chunkIndexOf(index);
+        m_chunks[c].insert(index - chunkStart(c), value);
+
+        for (int i = c ; i < m_ends.size() ; i++) {
+            m_ends[i]++;
+        }
+
+        if (m_chunks.at(c).size() >= m_chunkSize * 2) {
+            split(c);
+        }
+    }
+
+    void append(const T& value) {
+        if (m_chunks.isEmpty() || m_chunks.last().size() >= m_chunkSize) {
+            m_chunks.append(Chunk());
+            m_ends.append(size());
+        }
+        m_chunks.last().append(value);
+        m_ends.last()++;
+    }
+
+    void prepend(const T& value) {
+        insert(0, value);
+    }
+
+    void removeAt(int index) {
+        int c = chunkIndexOf(index);
+        m_chunks[c].remove(index - chunkStart(c));
+
+        for (int i = c ; i < m_ends.size() ; i++) {
+            m_ends[i]--;
+        }
+
+        if (m_chunks.at(c).isEmpty()) {
+            m_chunks.remove(c);
+            m_ends.remove(c);
+        }
+    }
+
+    void move(int from, int to) {
+        if (from == to) {
+            return;
+        }
+        T value = at(from);
+        removeAt(from);
+        insert(to, value);
+    }
+
+    QList<T> mid(int pos, int length) const {
+        QList<T> res;
+        if (length <= 0) {
+            return res;
+        }
+        res.reserve(length);
+
+        int c = chunkIndexOf(pos);
+        int i = pos - chunkStart(c);
+
+        while (res.size() < length && c < m_chunks.size()) {
+            const Chunk& chunk = m_chunks.at(c);
+            for (; i < chunk.size() && res.size() < length ; i++) {
+                res.append(chunk.at(i));
+            }
+            c++;
+            i = 0;
+        }
+        return res;
+    }
+
+    QList<T> toList() const {
+        return mid(0, size());
+    }
+
+    bool isSharedWith(const ChunkedList<T>& other) const {
+        return m_chunks.isSharedWith(other.m_chunks);
+    }
+
+    int chunkCount() const {
+        return m_chunks.size();
+    }
+
+    const Chunk& chunk(int index) const {
+        return m_chunks.at(index);
+    }
+
+    int chunkSize() const {
+        return m_chunkSize;
+    }
+
+private:
+
+    int chunkStart(int c) const {
+        return c == 0 ? 0 : m_ends.at(c - 1);
+    }
+
+    // Binary search the chunk that holds index
+    int chunkIndexOf(int index) const {
+        int low = 0;
+        int high = m_ends.size() - 1;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (m_ends.at(mid) <= index) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    void split(int c) {
+        Chunk chunk = m_chunks.at(c);
+        int half = chunk.size() / 2;
+
+        m_chunks[c] = chunk.mid(0, half);
+        m_chunks.insert(c + 1, chunk.mid(half));
+        m_ends.insert(c, chunkStart(c) + half);
+    }
+
+    int m_chunkSize;
+
+    QVector<Chunk> m_chunks;
+
+    // The end position (exclusive) of each chunk
+    QVector<int> m_ends;
+};
+
+}
@@ -0,0 +1,158 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablecompose.h"
+#include "priv/qimmutablepatchtoken_p.h"
+#include "priv/qimmutablelistpatcher_p.h"
+#include "priv/qimmutablefastdiffrunneralgo_p.h"
+
+using namespace QImmutable;
+
+// Merge a change of a field. Nested QSPatchSets are applied on a known list or chained.
+static QVariant merge(const QVariantMap& target, const QString& key, const QVariant& change)
+{
+    if (change.userType() != qMetaTypeId<QSPatchSet>() || !target.contains(key)) {
+        return change;
+    }
+
+    QVariant current = target.value(key);
+
+    if (current.userType() == qMetaTypeId<QSPatchSet>()) {
+        return QVariant::fromValue<QSPatchSet>(current.value<QSPatchSet>() + change.value<QSPatchSet>());
+    }
+
+    return ListPatcher::value(current, change);
+}
+
+// Apply the patches on a list of tokens
+static void apply(QList<PatchToken>& tokens, const QSPatchSet& patches, int& serial)
+{
+    foreach (QSPatch patch, patches) {
+        int from = patch.from();
+        int count = patch.count();
+
+        switch (patch.type()) {
+        case QSPatch::Remove:
+            if (count < 1 || from < 0 || from + count > tokens.size()) {
+                break;
+            }
+            tokens.erase(tokens.begin() + from, tokens.begin() + from + count);
+            break;
+        case QSPatch::Insert: {
+            QVariantList data = patch.data();
+            if (from < 0 || from > tokens.size()) {
+                break;
+            }
+            for (int i = 0 ; i < data.size() ; i++) {
+                PatchToken token;
+                token.serial = serial++;
+                token.data = data.at(i).toMap();
+                tokens.insert(from + i, token);
+            }
+            break;
+        }
+        case QSPatch::Move: {
+            int to = patch.to();
+            if (count <= 0 || from == to || from < 0 || to < 0 ||
+                from + count > tokens.size() || to + count > tokens.size()) {
+                break;
+            }
+            QList<PatchToken> block = tokens.mid(from, count);
+            tokens.erase(tokens.begin() + from, tokens.begin() + from + count);
+            for (int i = 0 ; i < block.size() ; i++) {
+                tokens.insert(to + i, block.at(i));
+            }
+            break;
+        }
+        case QSPatch::Reset: {
+            // All the original rows are replaced, the result is expressed as a removal and an insertion
+            QVariantList data = patch.data();
+            tokens.clear();
+            for (int i = 0 ; i < data.size() ; i++) {
+                PatchToken token;
+                token.serial = serial++;
+                token.data = data.at(i).toMap();
+                tokens.append(token);
+            }
+            break;
+        }
+        case QSPatch::Update: {
+            QVariantList data = patch.data();
+            QVariantMap diff = data.size() > 0 ? data.at(0).toMap() : QVariantMap();
+
+            if (from == tokens.size()) {
+                // Same as Patchable::set(), it is an append
+                PatchToken token;
+                token.serial = serial++;
+                token.data = diff;
+                tokens.append(token);
+                break;
+            } else if (from < 0 || from > tokens.size()) {
+                break;
+            }
+
+            QVariantMap& target = tokens[from].data;
+            QMapIterator<QString, QVariant> iter(diff);
+            while (iter.hasNext()) {
+                iter.next();
+                target[iter.key()] = merge(target, iter.key(), iter.value());
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+/*! \fn QSPatchSet QImmutable::compose(int count, const QSPatchSet& first, const QSPatchSet& second)
+
+    Composes two patch sets into a single equivalent patch set. The result
+    transforms a list with count items in the same way as applying first then second,
+    so the views only see the net changes.
+
+    Items inserted by first and removed by second are dropped, moves are chained, and
+    the updates to the same item are merged.
+ */
+
+QSPatchSet QImmutable::compose(int count, const QSPatchSet &first, const QSPatchSet &second)
+{
+    return squash(count, QList<QSPatchSet>() << first << second);
+}
+
+/*! \fn QSPatchSet QImmutable::squash(int count, const QList<QSPatchSet>& patchSets)
+
+    Squashes a sequence of patch sets, to be applied in order on a list with count items,
+    into a single equivalent patch set.
+
+    \sa compose
+ */
+
+QSPatchSet QImmutable::squash(int count, const QList<QSPatchSet> &patchSets)
+{
+    if (patchSets.isEmpty()) {
+        return QSPatchSet();
+    } else if (patchSets.size() == 1) {
+        return patchSets.first();
+    }
+
+    QList<PatchToken> from;
+    from.reserve(count);
+    for (int i = 0 ; i < count ; i++) {
+        from << PatchToken(i);
+    }
+
+    QList<PatchToken> to = from;
+    int serial = 0;
+
+    for (int i = 0 ; i < patchSets.size() ; i++) {
+        apply(to, patchSets.at(i), serial);
+    }
+
+    // The tokens carry their original position as key. Diff them to obtain the minimal patch set.
+    FastDiffRunnerAlgo<PatchToken> algo;
+    return algo.compare(from, to);
+}
@@ -0,0 +1,29 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include "qspatch.h"
+
+namespace QImmutable {
+
+    /// Compose two patch sets into a single equivalent patch set.
+    /*
+     The result transforms a list of count items in the same way as
+     applying "first" then "second". Insertions removed later are dropped,
+     moves are chained and the updates of a row are merged.
+
+     Example:
+
+        QSPatchSet patches = compose(model.count(), first, second);
+
+     */
+    QSPatchSet compose(int count, const QSPatchSet& first, const QSPatchSet& second);
+
+    /// Squash a sequence of patch sets into a single equivalent patch set.
+    QSPatchSet squash(int count, const QList<QSPatchSet>& patchSets);
+
+}
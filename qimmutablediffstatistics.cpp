@@ -0,0 +1,125 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablediffstatistics.h"
+
+using namespace QImmutable;
+
+/*! \class QImmutable::DiffStatistics
+    \inmodule QImmutable
+
+DiffStatistics records the cost of a comparison: the time spent on each phase, the no. of
+key, converter and hash table operations, the patches produced, and the fast paths taken.
+Set it to the statistics field of FastDiffRunnerAlgo or QSDiffRunnerAlgo to collect it.
+It is not collected by default, so a normal comparison doesn't pay for it.
+
+ListModel and QmlListModel publish it as the diffStatistics property after each sync
+if diffStatisticsEnabled is set.
+
+ */
+
+DiffStatistics::DiffStatistics()
+{
+    clear();
+}
+
+void DiffStatistics::clear()
+{
+    prefixScanTime = 0;
+    hashBuildTime = 0;
+    walkTime = 0;
+    fieldDiffTime = 0;
+    applyTime = 0;
+    totalTime = 0;
+
+    fromCount = 0;
+    toCount = 0;
+    skipped = 0;
+
+    keyCalls = 0;
+    converterCalls = 0;
+    hashProbes = 0;
+    treeOperations = 0;
+
+    insertPatches = 0;
+    removePatches = 0;
+    movePatches = 0;
+    updatePatches = 0;
+    resetPatches = 0;
+
+    sharedList = false;
+    appendToEnd = false;
+    removeFromEnd = false;
+}
+
+void DiffStatistics::countPatches(const QSPatchSet &patches)
+{
+    for (int i = 0 ; i < patches.size() ; i++) {
+        countPatch(patches.at(i));
+    }
+}
+
+void DiffStatistics::countPatch(const QSPatch &patch)
+{
+    switch (patch.type()) {
+    case QSPatch::Insert:
+        insertPatches++;
+        break;
+    case QSPatch::Remove:
+        removePatches++;
+        break;
+    case QSPatch::Move:
+        movePatches++;
+        break;
+    case QSPatch::Update:
+        updatePatches++;
+        break;
+    case QSPatch::Reset:
+        resetPatches++;
+        break;
+    default:
+        break;
+    }
+}
+
+/*! \fn QVariantMap QImmutable::DiffStatistics::toMap() const
+
+    Returns the statistics as a QVariantMap. The time fields are converted to ms, so it could
+    be read from QML and aggregated by a telemetry service.
+ */
+
+QVariantMap DiffStatistics::toMap() const
+{
+    QVariantMap res;
+
+    res["prefixScanTime"] = prefixScanTime / 1e6;
+    res["hashBuildTime"] = hashBuildTime / 1e6;
+    res["walkTime"] = walkTime / 1e6;
+    res["fieldDiffTime"] = fieldDiffTime / 1e6;
+    res["applyTime"] = applyTime / 1e6;
+    res["totalTime"] = totalTime / 1e6;
+
+    res["fromCount"] = fromCount;
+    res["toCount"] = toCount;
+    res["skipped"] = skipped;
+
+    res["keyCalls"] = keyCalls;
+    res["converterCalls"] = converterCalls;
+    res["hashProbes"] = hashProbes;
+    res["treeOperations"] = treeOperations;
+
+    res["insertPatches"] = insertPatches;
+    res["removePatches"] = removePatches;
+    res["movePatches"] = movePatches;
+    res["updatePatches"] = updatePatches;
+    res["resetPatches"] = resetPatches;
+
+    res["sharedList"] = sharedList;
+    res["appendToEnd"] = appendToEnd;
+    res["removeFromEnd"] = removeFromEnd;
+
+    return res;
+}
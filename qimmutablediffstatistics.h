@@ -0,0 +1,59 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QVariantMap>
+#include "qspatch.h"
+
+namespace QImmutable {
+
+/// The cost of a comparison and the way it was done. It is filled by a diff algo if it is set.
+class DiffStatistics {
+public:
+    DiffStatistics();
+
+    void clear();
+
+    // Count the patches by type
+    void countPatches(const QSPatchSet& patches);
+
+    void countPatch(const QSPatch& patch);
+
+    QVariantMap toMap() const;
+
+    // Time of the phases in ns. fieldDiffTime and applyTime (with a sink) overlap the other phases.
+    qint64 prefixScanTime;
+    qint64 hashBuildTime;
+    qint64 walkTime;
+    qint64 fieldDiffTime;
+    qint64 applyTime;
+    qint64 totalTime;
+
+    int fromCount;
+    int toCount;
+
+    // The no. of items skipped by the prefix scan
+    int skipped;
+
+    int keyCalls;
+    int converterCalls;
+    int hashProbes;
+    int treeOperations;
+
+    int insertPatches;
+    int removePatches;
+    int movePatches;
+    int updatePatches;
+    int resetPatches;
+
+    // The fast paths taken
+    bool sharedList;
+    bool appendToEnd;
+    bool removeFromEnd;
+};
+
+}
@@ -11,6 +11,10 @@ template <typename T>
 class FastDiffRunner {
 public:
     FastDiffRunner() {
+        m_identityKey = false;
+        m_resetRatio = -1;
+        m_resetMinimumSize = 100;
+        m_lastStrategy = KeyedDiff;
     }
 
     QSPatchSet compare(const QList<T>& from, const QList<T>& to) {
@@ -18,33 +22,39 @@ public:
         if (m_customConvertor != nullptr) {
             algo.converter = m_customConvertor;
         }
-        return algo.compare(from , to);
+        algo.nestedKeyFields = m_nestedKeyFields;
+        algo.identityKey = m_identityKey;
+        algo.resetRatio = m_resetRatio;
+        algo.resetMinimumSize = m_resetMinimumSize;
+        QSPatchSet res = algo.compare(from , to);
+        m_lastStrategy = algo.strategy();
+        return res;
+    }
+
+    QSPatchSet compare(const ChunkedList<T>& from, const ChunkedList<T>& to) {
+        QImmutable::FastDiffRunnerAlgo<T> algo;
+        if (m_customConvertor != nullptr) {
+            algo.converter = m_customConvertor;
+        }
+        algo.nestedKeyFields = m_nestedKeyFields;
+        algo.identityKey = m_identityKey;
+        algo.resetRatio = m_resetRatio;
+        algo.resetMinimumSize = m_resetMinimumSize;
+        QSPatchSet res = algo.compare(from , to);
+        m_lastStrategy = algo.strategy();
+        return res;
     }
 
     bool patch(Patchable *patchable, const QSPatchSet& patches) const
     {
-        QVariantMap diff;
-        foreach (QSPatch patch, patches) {
-            switch (patch.type()) {
-            case QSPatch::Remove:
-                patchable->remove(patch.from(), patch.count());
-                break;
-            case QSPatch::Insert:
-                patchable->insert(patch.from(), patch.data());
-                break;
-            case QSPatch::Move:
-                patchable->move(patch.from(), patch.to(), patch.count());
-                break;
-            case QSPatch::Update:
-                if (patch.data().size() > 0) {
-                    diff = patch.data().at(0).toMap();
-                }
-                patchable->set(patch.from(), diff);
-                break;
-            default:
-                break;
-            }
-        }
+        applyPatches(patchable, patches);
+        return true;
+    }
+
+    // The payloads of the patches are moved to a BatchPatchable
+    bool patch(Patchable *patchable, QSPatchSet&& patches) const
+    {
+        applyPatches(patchable, std::move(patches));
         return true;
     }
 
@@ -53,9 +63,52 @@ public:
         m_customConvertor = customConvertor;
     }
 
+    // Produce a sub-QSPatchSet for a changed list field. See QSDiffRunner::setNestedKeyField()
+    void setNestedKeyField(const QString& field, const QString& keyField) {
+        if (keyField.isEmpty()) {
+            m_nestedKeyFields.remove(field);
+        } else {
+            m_nestedKeyFields[field] = keyField;
+        }
+    }
+
+    // Match the items of a type without key() by their identity. Therefore, a reorder of
+    // shared items becomes move patches instead of updates. It is ignored for QJSValue.
+    void setIdentityKeyEnabled(bool enabled) {
+        m_identityKey = enabled;
+    }
+
+    bool identityKeyEnabled() const {
+        return m_identityKey;
+    }
+
+    // Produce a single Reset patch if the estimated no. of changes exceeds ratio times the size of
+    // a list with at least minimumSize items. A negative ratio disables it.
+    void setResetThreshold(qreal ratio, int minimumSize = 100) {
+        m_resetRatio = ratio;
+        m_resetMinimumSize = minimumSize;
+    }
+
+    qreal resetThreshold() const {
+        return m_resetRatio;
+    }
+
+    // The strategy chosen by the last compare()
+    DiffStrategy lastStrategy() const {
+        return m_lastStrategy;
+    }
+
 private:
     std::function<QVariantMap(T, int)> m_customConvertor;
 
+    bool m_identityKey;
+
+    qreal m_resetRatio;
+    int m_resetMinimumSize;
+    DiffStrategy m_lastStrategy;
+
+    QHash<QString, QString> m_nestedKeyFields;
+
 };
 
 
@@ -1,6 +1,7 @@
 #include <QMetaProperty>
 #include <QtQml>
 #include "qimmutablefunctions.h"
+#include "qsdiffrunner.h"
 
 void QImmutable::assign(QVariantMap &dest, const QObject *source)
 {
@@ -269,17 +270,19 @@ QVariantMap QImmutable::omit(const QVariantMap &source, const QVariantMap &prope
 
 QVariantMap QImmutable::diff(const QVariantMap &v1, const QVariantMap &v2)
 {
-    auto prev = v1;
-    auto current = v2;
-
     QVariantMap res;
-    QMap<QString, QVariant>::const_iterator iter = current.begin();
 
-    while (iter != current.end()) {
-        QString key = iter.key();
-        if (!prev.contains(key) ||
-             prev[key] != iter.value()) {
-            res[key] = iter.value();
+    if (v1.isSharedWith(v2)) {
+        return res;
+    }
+
+    QMap<QString, QVariant>::const_iterator iter = v2.constBegin();
+
+    while (iter != v2.constEnd()) {
+        QMap<QString, QVariant>::const_iterator prev = v1.constFind(iter.key());
+        if (prev == v1.constEnd() ||
+            !fastCompare(prev.value(), iter.value())) {
+            res[iter.key()] = iter.value();
         }
         iter++;
     }
@@ -287,12 +290,116 @@ QVariantMap QImmutable::diff(const QVariantMap &v1, const QVariantMap &v2)
     return res;
 }
 
-bool QImmutable::fastCompare(QVariant v1, QVariant v2)
+QVariantMap QImmutable::diff(const QVariantMap &v1, const QVariantMap &v2, const QHash<QString, QString> &nestedKeyFields)
 {
-    if (v1.userType() != v2.userType()) {
-        return false;
+    QVariantMap res = diff(v1, v2);
+
+    if (nestedKeyFields.isEmpty() || res.isEmpty()) {
+        return res;
+    }
+
+    QHash<QString, QString>::const_iterator iter = nestedKeyFields.constBegin();
+    while (iter != nestedKeyFields.constEnd()) {
+        QMap<QString, QVariant>::iterator current = res.find(iter.key());
+        QMap<QString, QVariant>::const_iterator prev = v1.constFind(iter.key());
+
+        if (current != res.end() && prev != v1.constEnd() &&
+            current.value().userType() == QMetaType::QVariantList &&
+            prev.value().userType() == QMetaType::QVariantList) {
+
+            QSDiffRunner runner;
+            runner.setKeyField(iter.value());
+            QSPatchSet patches = runner.compare(prev.value().toList(), current.value().toList());
+
+            if (patches.isEmpty()) {
+                res.erase(current);
+            } else {
+                current.value() = QVariant::fromValue<QSPatchSet>(patches);
+            }
+        }
+        iter++;
+    }
+
+    return res;
+}
+
+template <typename T>
+static inline const T& data(const QVariant& v)
+{
+    return *static_cast<const T*>(v.constData());
+}
+
+bool QImmutable::fastCompare(const QVariant& v1, const QVariant& v2)
+{
+    int type = v1.userType();
+
+    if (type != v2.userType()) {
+        // Let QVariant convert the values (e.g int and double)
+        return v1 == v2;
+    }
+
+    switch (type) {
+    case QMetaType::UnknownType:
+        return true;
+    case QMetaType::QString:
+        return data<QString>(v1).isSharedWith(data<QString>(v2)) || data<QString>(v1) == data<QString>(v2);
+    case QMetaType::QByteArray:
+        return data<QByteArray>(v1).isSharedWith(data<QByteArray>(v2)) || data<QByteArray>(v1) == data<QByteArray>(v2);
+    case QMetaType::QStringList:
+        return data<QStringList>(v1).isSharedWith(data<QStringList>(v2)) || data<QStringList>(v1) == data<QStringList>(v2);
+    case QMetaType::QVariantList: {
+        const QVariantList& l1 = data<QVariantList>(v1);
+        const QVariantList& l2 = data<QVariantList>(v2);
+
+        if (l1.isSharedWith(l2)) {
+            return true;
+        } else if (l1.size() != l2.size()) {
+            return false;
+        }
+
+        for (int i = 0 ; i < l1.size() ; i++) {
+            if (!fastCompare(l1.at(i), l2.at(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap& m1 = data<QVariantMap>(v1);
+        const QVariantMap& m2 = data<QVariantMap>(v2);
+
+        if (m1.isSharedWith(m2)) {
+            return true;
+        } else if (m1.size() != m2.size()) {
+            return false;
+        }
+
+        // Both are sorted by key
+        QMap<QString, QVariant>::const_iterator i1 = m1.constBegin();
+        QMap<QString, QVariant>::const_iterator i2 = m2.constBegin();
+        while (i1 != m1.constEnd()) {
+            if (i1.key() != i2.key() || !fastCompare(i1.value(), i2.value())) {
+                return false;
+            }
+            i1++;
+            i2++;
+        }
+        return true;
+    }
+    default:
+        break;
+    }
+
+    if (type == qMetaTypeId<QJSValue>()) {
+        return data<QJSValue>(v1).strictlyEquals(data<QJSValue>(v2));
+    }
+
+    if (QMetaType::typeFlags(type) & QMetaType::IsGadget) {
+        // An immutable gadget holds a d-pointer only. The same content means the same instance.
+        if (memcmp(v1.constData(), v2.constData(), QMetaType::sizeOf(type)) == 0) {
+            return true;
+        }
     }
 
-    //@TODO FIXME
     return v1 == v2;
 }
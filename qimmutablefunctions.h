@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QJSValue>
 #include <QVariant>
+#include <QHash>
 #include <string.h>
 #include <QMetaProperty>
 #include <QDebug>
@@ -125,12 +126,22 @@ namespace QImmutable {
     QVariantMap omit(const QVariantMap& source, const QVariantMap& properties);
 
     /// Compare two variant in a fast way. If it is a immutable type, it will simply compare the instance
-    bool fastCompare(QVariant v1, QVariant v2);
+    /*
+     Implicitly shared values (QString, QByteArray, QVariantList, QVariantMap, QStringList) sharing
+     the same data, gadgets with identical content (e.g the same d-pointer) and the same QJSValue are
+     considered equal in O(1). Nested lists and maps are compared with the same rule per child.
+     */
+    bool fastCompare(const QVariant& v1, const QVariant& v2);
 
     /// Find out the diff between QVariantMap
 
     QVariantMap diff(const QVariantMap& v1, const QVariantMap& v2);
 
+    /// Find out the diff between QVariantMap. A changed list field listed in nestedKeyFields is
+    /// replaced by a QSPatchSet (in a QVariant) that transforms the old list to the new one,
+    /// compared with the key field given by nestedKeyFields.
+    QVariantMap diff(const QVariantMap& v1, const QVariantMap& v2, const QHash<QString, QString>& nestedKeyFields);
+
     template <typename T>
     bool isShared(const T& v1, const T& v2) {
         return memcmp(&v1, &v2 , sizeof(T)) == 0;
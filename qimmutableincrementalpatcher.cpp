@@ -0,0 +1,184 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutableincrementalpatcher.h"
+
+using namespace QImmutable;
+
+/*! \class QImmutable::IncrementalPatcher
+    \inmodule QImmutable
+
+IncrementalPatcher applies a patch set to a Patchable across event loop turns.
+On each turn, it applies patches until the budget (in ms) is used up, and then yields to the event loop.
+So a huge patch set no longer blocks the UI in one go.
+
+An insertion or removal with more than chunkSize rows is split into smaller ones.
+Every step is a complete patch, so the target (e.g a VariantListModel) is in a valid state
+between the turns, and views receive consistent signals.
+
+The syncing property is true until all the patches are applied, and then the finished() signal is emitted.
+
+While syncing, the target is in an intermediate state. A new patch set passed to patch() must be
+calculated against the current content of the target (e.g VariantListModel::storage()), it
+replaces the remaining patches of the previous one.
+
+The target must remain valid until finished() is emitted or abort() is called.
+ */
+
+IncrementalPatcher::IncrementalPatcher(QObject *parent) : QObject(parent)
+{
+    m_budget = 8;
+    m_chunkSize = 256;
+    m_syncing = false;
+    m_target = 0;
+    m_index = 0;
+
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(run()));
+}
+
+int IncrementalPatcher::budget() const
+{
+    return m_budget;
+}
+
+void IncrementalPatcher::setBudget(int budget)
+{
+    m_budget = budget;
+    emit budgetChanged();
+}
+
+int IncrementalPatcher::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+void IncrementalPatcher::setChunkSize(int chunkSize)
+{
+    m_chunkSize = qMax(chunkSize, 1);
+    emit chunkSizeChanged();
+}
+
+bool IncrementalPatcher::syncing() const
+{
+    return m_syncing;
+}
+
+int IncrementalPatcher::pendingCount() const
+{
+    return m_steps.size() - m_index;
+}
+
+/*! \fn void QImmutable::IncrementalPatcher::patch(Patchable *target, const QSPatchSet &patches)
+
+    Starts applying patches to target. The first turn runs on the next event loop iteration.
+ */
+
+void IncrementalPatcher::patch(Patchable *target, const QSPatchSet &patches)
+{
+    m_target = target;
+    m_steps.clear();
+    m_index = 0;
+
+    for (int i = 0 ; i < patches.size() ; i++) {
+        split(patches.at(i), m_steps);
+    }
+
+    if (m_steps.isEmpty()) {
+        m_timer.stop();
+        if (m_syncing) {
+            setSyncing(false);
+            emit finished();
+        }
+        return;
+    }
+
+    setSyncing(true);
+    m_timer.start();
+}
+
+void IncrementalPatcher::finish()
+{
+    m_timer.stop();
+
+    if (!m_syncing) {
+        return;
+    }
+
+    while (m_index < m_steps.size()) {
+        apply(m_steps.at(m_index++));
+    }
+
+    m_steps.clear();
+    m_index = 0;
+    setSyncing(false);
+    emit finished();
+}
+
+void IncrementalPatcher::abort()
+{
+    m_timer.stop();
+    m_steps.clear();
+    m_index = 0;
+    m_target = 0;
+    setSyncing(false);
+}
+
+void IncrementalPatcher::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // At least one step per turn
+    do {
+        apply(m_steps.at(m_index++));
+    } while (m_index < m_steps.size() && timer.elapsed() < m_budget);
+
+    if (m_index < m_steps.size()) {
+        m_timer.start();
+        return;
+    }
+
+    m_steps.clear();
+    m_index = 0;
+    setSyncing(false);
+    emit finished();
+}
+
+void IncrementalPatcher::split(const QSPatch &patch, QSPatchSet &steps) const
+{
+    if (patch.type() == QSPatch::Insert && patch.count() > m_chunkSize) {
+        QVariantList data = patch.data();
+        for (int i = 0 ; i < data.size() ; i += m_chunkSize) {
+            QVariantList part = data.mid(i, m_chunkSize);
+            int from = patch.from() + i;
+            steps << QSPatch(QSPatch::Insert, from, from + part.size() - 1, part.size(), part);
+        }
+    } else if (patch.type() == QSPatch::Remove && patch.count() > m_chunkSize) {
+        // The rows after the removed part shift up, so every part starts at the same index
+        for (int remaining = patch.count() ; remaining > 0 ; remaining -= m_chunkSize) {
+            int count = qMin(remaining, m_chunkSize);
+            steps << QSPatch::createRemove(patch.from(), patch.from() + count - 1);
+        }
+    } else {
+        steps << patch;
+    }
+}
+
+void IncrementalPatcher::apply(const QSPatch &patch)
+{
+    applyPatch(m_target, patch);
+}
+
+void IncrementalPatcher::setSyncing(bool value)
+{
+    if (m_syncing == value) {
+        return;
+    }
+    m_syncing = value;
+    emit syncingChanged();
+}
@@ -0,0 +1,85 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include "qspatch.h"
+#include "qimmutablepatchable.h"
+
+namespace QImmutable {
+
+/// Applies a patch set across event loop turns within a time budget per turn.
+/*
+ Example:
+
+    IncrementalPatcher patcher;
+    patcher.setBudget(8);
+
+    QSPatchSet patches = runner.compare(model.storage(), list);
+    patcher.patch(&model, patches);
+
+ */
+class IncrementalPatcher : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int budget READ budget WRITE setBudget NOTIFY budgetChanged)
+    Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize NOTIFY chunkSizeChanged)
+    Q_PROPERTY(bool syncing READ syncing NOTIFY syncingChanged)
+
+public:
+    explicit IncrementalPatcher(QObject *parent = 0);
+
+    int budget() const;
+    void setBudget(int budget);
+
+    int chunkSize() const;
+    void setChunkSize(int chunkSize);
+
+    bool syncing() const;
+
+    // No. of steps not applied yet
+    int pendingCount() const;
+
+    // Start applying patches to target. The remaining patches of the previous call are discarded.
+    void patch(Patchable* target, const QSPatchSet& patches);
+
+public slots:
+    // Apply all the remaining patches immediately
+    void finish();
+
+    // Discard the remaining patches
+    void abort();
+
+signals:
+    void budgetChanged();
+    void chunkSizeChanged();
+    void syncingChanged();
+    void finished();
+
+private slots:
+    void run();
+
+private:
+    // Split a patch into smaller steps. Each step leaves the target in a valid state.
+    void split(const QSPatch& patch, QSPatchSet& steps) const;
+
+    void apply(const QSPatch& patch);
+
+    void setSyncing(bool value);
+
+    int m_budget;
+    int m_chunkSize;
+    bool m_syncing;
+
+    Patchable* m_target;
+    QSPatchSet m_steps;
+    int m_index;
+    QTimer m_timer;
+};
+
+}
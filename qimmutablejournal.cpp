@@ -0,0 +1,512 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablejournal.h"
+#include "priv/qimmutablelistpatcher_p.h"
+
+using namespace QImmutable;
+
+static const quint32 SnapshotMagic = 0x51494d53; // QIMS
+static const quint32 JournalMagic = 0x51494d4a; // QIMJ
+static const quint32 FormatVersion = 1;
+static const int StreamVersion = QDataStream::Qt_5_0;
+
+namespace {
+
+// Write the snapshot, then remove the journals merged into it
+class CompactionTask : public QRunnable {
+public:
+    void run() {
+        bool succeeded = Journal::writeSnapshot(fileName, generation, storage);
+        if (succeeded) {
+            foreach (QString journal, obsoleted) {
+                QFile::remove(journal);
+            }
+        }
+        QMetaObject::invokeMethod(journal, "onCompacted", Qt::QueuedConnection, Q_ARG(bool, succeeded));
+    }
+
+    Journal* journal;
+    QString fileName;
+    int generation;
+    QVariantList storage;
+    QStringList obsoleted;
+};
+
+}
+
+// Scan a journal file. Returns the size of the valid records, or -1 if it is not a journal.
+// The records are applied to list if it is not null.
+static qint64 scanJournal(const QString& fileName, QVariantList* list)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(StreamVersion);
+
+    quint32 magic, version;
+    qint32 generation;
+    stream >> magic >> version >> generation;
+
+    if (stream.status() != QDataStream::Ok || magic != JournalMagic || version != FormatVersion) {
+        return -1;
+    }
+
+    QVariantList unused;
+    ListPatcher patcher(list != 0 ? *list : unused);
+    qint64 valid = file.pos();
+
+    while (!stream.atEnd()) {
+        quint32 size;
+        stream >> size;
+
+        if (stream.status() != QDataStream::Ok || file.size() - file.pos() < (qint64) size) {
+            // An incomplete record written on crash
+            qWarning() << "Journal: Discard an incomplete record in" << fileName;
+            break;
+        }
+
+        if (list == 0) {
+            file.seek(file.pos() + size);
+        } else {
+            QByteArray payload = file.read(size);
+            QDataStream record(payload);
+            record.setVersion(StreamVersion);
+            QSPatch patch;
+            record >> patch;
+
+            if (record.status() != QDataStream::Ok) {
+                qWarning() << "Journal: Discard a malformed record in" << fileName;
+                break;
+            }
+
+            patcher.patch(patch);
+        }
+
+        valid = file.pos();
+    }
+
+    return valid;
+}
+
+// Read the generation from the header of a snapshot. Returns -1 if not available
+static int snapshotGeneration(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(StreamVersion);
+
+    quint32 magic, version;
+    qint32 generation;
+    stream >> magic >> version >> generation;
+
+    if (stream.status() != QDataStream::Ok || magic != SnapshotMagic || version != FormatVersion) {
+        return -1;
+    }
+
+    return generation;
+}
+
+/*! \class QImmutable::Journal
+    \inmodule QImmutable
+
+Journal persists a list with a binary snapshot and an append-only journal of the patches applied after it.
+It implements the Patchable interface, so the patches applied to a model could be applied to the journal
+as well. A sync costs O(patch) on disk instead of rewriting the whole list.
+
+Files:
+
+\list
+  \li path - The snapshot. It is written by QDataStream and loaded by memory mapping.
+  \li path.journal.N - The journal of generation N. Each record is a length prefixed QSPatch.
+\endlist
+
+compact() starts journal N + 1 and writes the storage as the snapshot of generation N + 1
+in a background thread. The older journals are removed afterward. If the process stops before
+that, load() still restores from the previous snapshot and the journals after it.
+
+An incomplete record at the end of a journal (e.g written on crash) is discarded.
+
+ */
+
+Journal::Journal(QObject *parent) : QObject(parent)
+{
+    m_generation = -1;
+    m_compacting = false;
+    m_pool.setMaxThreadCount(1);
+}
+
+Journal::~Journal()
+{
+    m_pool.waitForDone();
+    close();
+}
+
+QString Journal::path() const
+{
+    return m_path;
+}
+
+void Journal::setPath(const QString &path)
+{
+    if (isOpen()) {
+        qWarning() << "Journal::setPath() - Unable to change the path of an opened journal";
+        return;
+    }
+
+    m_path = path;
+    m_generation = -1;
+    emit pathChanged();
+}
+
+/*! \fn QVariantList QImmutable::Journal::load()
+
+    Reads the snapshot and replays the journals after it. Returns the restored list.
+    If there is no snapshot and journal, an empty list is returned.
+ */
+
+QVariantList Journal::load()
+{
+    QVariantList storage;
+    int generation = 0;
+
+    if (QFile::exists(m_path) && !readSnapshot(m_path, &generation, &storage)) {
+        qWarning() << "Journal::load() - Failed to read the snapshot:" << m_path;
+        generation = 0;
+        storage.clear();
+    }
+
+    m_generation = generation;
+
+    QList<int> generations = journalGenerations();
+    for (int i = 0 ; i < generations.size() ; i++) {
+        int g = generations.at(i);
+        if (g < generation) {
+            // Merged into the snapshot already
+            continue;
+        }
+        scanJournal(journalFileName(g), &storage);
+        m_generation = g;
+    }
+
+    return storage;
+}
+
+/*! \fn bool QImmutable::Journal::open()
+
+    Opens the latest journal for appending. It should be called after load().
+    Returns false if the journal could not be opened.
+ */
+
+bool Journal::open()
+{
+    if (isOpen()) {
+        return true;
+    }
+
+    if (m_generation < 0) {
+        QList<int> generations = journalGenerations();
+        m_generation = qMax(snapshotGeneration(m_path), generations.isEmpty() ? 0 : generations.last());
+    }
+
+    return openJournal(m_generation);
+}
+
+void Journal::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+bool Journal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+int Journal::generation() const
+{
+    return m_generation;
+}
+
+/*! \fn qint64 QImmutable::Journal::journalSize() const
+
+    Returns the size of the current journal in bytes. It could be used to decide when to compact.
+ */
+
+qint64 Journal::journalSize() const
+{
+    return m_file.isOpen() ? m_file.size() : 0;
+}
+
+bool Journal::compacting() const
+{
+    return m_compacting;
+}
+
+void Journal::append(const QSPatch &patch)
+{
+    write(patch);
+    m_file.flush();
+}
+
+/*! \fn void QImmutable::Journal::append(const QSPatchSet &patches)
+
+    Appends the patches to the journal and flushes it once.
+ */
+
+void Journal::append(const QSPatchSet &patches)
+{
+    for (int i = 0 ; i < patches.size() ; i++) {
+        write(patches.at(i));
+    }
+    m_file.flush();
+}
+
+/*! \fn void QImmutable::Journal::compact(const QVariantList &storage)
+
+    Starts a new journal and writes storage as its snapshot in a background thread.
+    storage must be the list with all the patches appended so far, e.g VariantListModel::storage().
+    The compacted() signal is emitted when it is done.
+ */
+
+void Journal::compact(const QVariantList &storage)
+{
+    if (!isOpen()) {
+        qWarning() << "Journal::compact() - The journal is not opened";
+        return;
+    }
+
+    waitForCompaction();
+
+    int next = m_generation + 1;
+
+    QStringList obsoleted;
+    QList<int> generations = journalGenerations();
+    for (int i = 0 ; i < generations.size() ; i++) {
+        if (generations.at(i) < next) {
+            obsoleted << journalFileName(generations.at(i));
+        }
+    }
+
+    close();
+    if (!openJournal(next)) {
+        return;
+    }
+
+    CompactionTask* task = new CompactionTask();
+    task->journal = this;
+    task->fileName = m_path;
+    task->generation = next;
+    // Implicitly shared, the caller's changes after this point are not visible to the task
+    task->storage = storage;
+    task->obsoleted = obsoleted;
+
+    m_compacting = true;
+    emit compactingChanged();
+
+    m_pool.start(task);
+}
+
+/*! \fn void QImmutable::Journal::waitForCompaction()
+
+    Blocks until the running compaction is finished.
+ */
+
+void Journal::waitForCompaction()
+{
+    if (!m_compacting) {
+        return;
+    }
+    m_pool.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+void Journal::insert(int index, const QVariantList &value)
+{
+    append(QSPatch(QSPatch::Insert, index, index + value.size() - 1, value.size(), value));
+}
+
+void Journal::move(int from, int to, int count)
+{
+    append(QSPatch(QSPatch::Move, from, to, count));
+}
+
+void Journal::remove(int i, int count)
+{
+    append(QSPatch::createRemove(i, i + count - 1));
+}
+
+void Journal::set(int index, QVariantMap dict)
+{
+    append(QSPatch::createUpdate(index, dict));
+}
+
+/*! \fn bool QImmutable::Journal::writeSnapshot(const QString &fileName, int generation, const QVariantList &storage)
+
+    Writes storage to a snapshot file. The file is replaced atomically.
+ */
+
+bool Journal::writeSnapshot(const QString &fileName, int generation, const QVariantList &storage)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Journal::writeSnapshot() - Failed to open" << fileName;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(StreamVersion);
+    stream << SnapshotMagic << FormatVersion << (qint32) generation << storage;
+
+    if (stream.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+/*! \fn bool QImmutable::Journal::readSnapshot(const QString &fileName, int *generation, QVariantList *storage)
+
+    Reads a snapshot file written by writeSnapshot(). The file is memory mapped if possible.
+ */
+
+bool Journal::readSnapshot(const QString &fileName, int *generation, QVariantList *storage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray bytes;
+    uchar* data = file.size() > 0 ? file.map(0, file.size()) : 0;
+
+    if (data != 0) {
+        bytes = QByteArray::fromRawData((const char*) data, file.size());
+    } else {
+        bytes = file.readAll();
+    }
+
+    QDataStream stream(bytes);
+    stream.setVersion(StreamVersion);
+
+    quint32 magic, version;
+    qint32 gen;
+    QVariantList list;
+
+    stream >> magic >> version >> gen;
+
+    bool succeeded = false;
+
+    if (stream.status() == QDataStream::Ok && magic == SnapshotMagic && version == FormatVersion) {
+        stream >> list;
+        succeeded = stream.status() == QDataStream::Ok;
+    }
+
+    if (succeeded) {
+        // The items are deep copied by QDataStream, it is safe to unmap.
+        *generation = gen;
+        *storage = list;
+    }
+
+    bytes.clear();
+    if (data != 0) {
+        file.unmap(data);
+    }
+
+    return succeeded;
+}
+
+void Journal::onCompacted(bool succeeded)
+{
+    m_compacting = false;
+    emit compactingChanged();
+
+    if (succeeded) {
+        emit compacted();
+    } else {
+        qWarning() << "Journal::compact() - Failed to write the snapshot:" << m_path;
+    }
+}
+
+QString Journal::journalFileName(int generation) const
+{
+    return QString("%1.journal.%2").arg(m_path).arg(generation);
+}
+
+QList<int> Journal::journalGenerations() const
+{
+    QFileInfo info(m_path);
+    QString prefix = info.fileName() + ".journal.";
+    QStringList files = info.dir().entryList(QStringList() << prefix + "*", QDir::Files);
+
+    QList<int> res;
+    for (int i = 0 ; i < files.size() ; i++) {
+        bool ok = false;
+        int generation = files.at(i).mid(prefix.size()).toInt(&ok);
+        if (ok) {
+            res << generation;
+        }
+    }
+
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+bool Journal::openJournal(int generation)
+{
+    QString fileName = journalFileName(generation);
+
+    qint64 valid = QFile::exists(fileName) ? scanJournal(fileName, 0) : 0;
+
+    m_file.setFileName(fileName);
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Journal::open() - Failed to open" << fileName;
+        return false;
+    }
+
+    if (valid <= 0) {
+        // New or unreadable, start over
+        m_file.resize(0);
+        QDataStream stream(&m_file);
+        stream.setVersion(StreamVersion);
+        stream << JournalMagic << FormatVersion << (qint32) generation;
+    } else if (valid < m_file.size()) {
+        m_file.resize(valid);
+    }
+
+    m_file.seek(m_file.size());
+    m_file.flush();
+    m_generation = generation;
+    return true;
+}
+
+void Journal::write(const QSPatch &patch)
+{
+    if (!m_file.isOpen()) {
+        qWarning() << "Journal - The journal is not opened";
+        return;
+    }
+
+    QByteArray payload;
+    QDataStream record(&payload, QIODevice::WriteOnly);
+    record.setVersion(StreamVersion);
+    record << patch;
+
+    QDataStream stream(&m_file);
+    stream.setVersion(StreamVersion);
+    stream << (quint32) payload.size();
+    stream.writeRawData(payload.constData(), payload.size());
+}
@@ -0,0 +1,113 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QFile>
+#include <QThreadPool>
+#include "qspatch.h"
+#include "qimmutablepatchable.h"
+
+namespace QImmutable {
+
+/// Persists a list by a binary snapshot and an append-only journal of patches.
+/*
+ Example:
+
+    Journal journal;
+    journal.setPath(dir + "/cards");
+    model.setStorage(journal.load());
+    journal.open();
+
+    // On every sync
+    QSPatchSet patches = runner.compare(model.storage(), list);
+    runner.patch(&model, patches);
+    journal.append(patches);
+
+    // Occasionally
+    if (journal.journalSize() > limit) {
+        journal.compact(model.storage());
+    }
+
+ */
+class Journal : public QObject, public Patchable
+{
+    Q_OBJECT
+    Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
+    Q_PROPERTY(bool compacting READ compacting NOTIFY compactingChanged)
+
+public:
+    explicit Journal(QObject *parent = 0);
+    ~Journal();
+
+    QString path() const;
+    void setPath(const QString &path);
+
+    // Read the snapshot and replay the journals after it
+    QVariantList load();
+
+    // Open the latest journal for appending
+    bool open();
+
+    void close();
+
+    bool isOpen() const;
+
+    // The generation of the journal being appended
+    int generation() const;
+
+    qint64 journalSize() const;
+
+    bool compacting() const;
+
+    void append(const QSPatch& patch);
+
+    void append(const QSPatchSet& patches);
+
+    // Start a new journal and write storage as its snapshot in background
+    void compact(const QVariantList& storage);
+
+    void waitForCompaction();
+
+    virtual void insert(int index, const QVariantList &value);
+
+    virtual void move(int from, int to, int count);
+
+    virtual void remove(int i , int count = 1);
+
+    virtual void set(int index, QVariantMap dict);
+
+    static bool writeSnapshot(const QString& fileName, int generation, const QVariantList& storage);
+
+    static bool readSnapshot(const QString& fileName, int* generation, QVariantList* storage);
+
+signals:
+    void pathChanged();
+    void compactingChanged();
+    void compacted();
+
+private slots:
+    void onCompacted(bool succeeded);
+
+private:
+    QString journalFileName(int generation) const;
+
+    // Returns the generations of the journals on disk in ascending order
+    QList<int> journalGenerations() const;
+
+    bool openJournal(int generation);
+
+    void write(const QSPatch& patch);
+
+    QString m_path;
+    QFile m_file;
+    int m_generation;
+    bool m_compacting;
+    QThreadPool m_pool;
+};
+
+}
@@ -10,8 +10,136 @@ namespace QImmutable {
     template <typename T>
     class ListModel: public VariantListModel {
     public:
+
+        // A transaction of explicit changes. It produces the patches directly without comparing the whole list.
+        class Editor {
+        public:
+            explicit Editor(ListModel<T>* model) : m_model(model) {
+            }
+
+            Editor& insert(int index, const T& value) {
+                m_operations << Operation(QSPatch::Insert, index, QString(), value);
+                return *this;
+            }
+
+            Editor& append(const T& value) {
+                m_operations << Operation(QSPatch::Insert, -1, QString(), value);
+                return *this;
+            }
+
+            Editor& remove(int index) {
+                m_operations << Operation(QSPatch::Remove, index, QString(), T());
+                return *this;
+            }
+
+            Editor& removeKey(const QString& key) {
+                m_operations << Operation(QSPatch::Remove, -1, key, T());
+                return *this;
+            }
+
+            Editor& update(int index, const T& value) {
+                m_operations << Operation(QSPatch::Update, index, QString(), value);
+                return *this;
+            }
+
+            Editor& update(const QString& key, const T& value) {
+                m_operations << Operation(QSPatch::Update, -1, key, value);
+                return *this;
+            }
+
+            // Apply the changes to the source and the model
+            void commit() {
+                QList<T> source = m_model->m_source;
+                QSPatchSet patches;
+                Item<T> wrapper;
+
+                // The key table of the model is kept in sync with the edits at the end of the list and
+                // the updates, so the next transaction reuses it. An insertion or removal before the end
+                // shifts the rows after it, so the table is dropped and the next key lookup rebuilds it.
+                QHash<QString, int>& keys = m_model->m_keyIndex;
+
+                for (int i = 0 ; i < m_operations.size() ; i++) {
+                    const Operation& op = m_operations.at(i);
+                    int index = op.index;
+
+                    if (!op.key.isNull()) {
+                        m_model->buildKeyIndex(source);
+                        index = keys.value(op.key, -1);
+                    } else if (op.type == QSPatch::Insert && index < 0) {
+                        index = source.size();
+                    }
+
+                    if (index < 0 || index > source.size() ||
+                        (op.type != QSPatch::Insert && index == source.size())) {
+                        qWarning() << "ListModel::Editor::commit() - Invalid index or key";
+                        continue;
+                    }
+
+                    bool tracking = m_model->m_keyIndexValid && wrapper.hasKey();
+
+                    if (op.type == QSPatch::Insert) {
+                        if (tracking && index == source.size()) {
+                            keys.insert(wrapper.key(op.value), index);
+                        } else {
+                            m_model->invalidateKeyIndex();
+                        }
+                        source.insert(index, op.value);
+                        patches << QSPatch(QSPatch::Insert, index, index, 1, QImmutable::convert(op.value));
+                    } else if (op.type == QSPatch::Remove) {
+                        if (tracking && index == source.size() - 1) {
+                            keys.remove(wrapper.key(source.at(index)));
+                        } else {
+                            m_model->invalidateKeyIndex();
+                        }
+                        source.removeAt(index);
+                        patches << QSPatch::createRemove(index, index);
+                    } else if (op.type == QSPatch::Update) {
+                        T prev = source.at(index);
+                        source[index] = op.value;
+                        if (wrapper.isShared(prev, op.value)) {
+                            continue;
+                        }
+                        if (tracking) {
+                            QString prevKey = wrapper.key(prev);
+                            QString key = wrapper.key(op.value);
+                            if (prevKey != key) {
+                                keys.remove(prevKey);
+                                keys.insert(key, index);
+                            }
+                        }
+                        QVariantMap diff = QImmutable::diff(QImmutable::convert(prev), QImmutable::convert(op.value));
+                        if (diff.size() > 0) {
+                            patches << QSPatch::createUpdate(index, diff);
+                        }
+                    }
+                }
+
+                m_operations.clear();
+                m_model->commit(source, patches);
+            }
+
+        private:
+            class Operation {
+            public:
+                Operation(QSPatch::Type type, int index, const QString& key, const T& value) :
+                    type(type), index(index), key(key), value(value) {
+                }
+
+                QSPatch::Type type;
+                int index;
+                QString key;
+                T value;
+            };
+
+            ListModel<T>* m_model;
+            QList<Operation> m_operations;
+        };
+
         ListModel(QObject* parent = 0) : VariantListModel(parent) {
             m_processing = false;
+            m_pending = false;
+            m_keyIndexValid = false;
+            m_algo.sink = this;
         }
 
         QList<T> source() const
@@ -21,46 +149,191 @@ namespace QImmutable {
 
         void setSource(const QList<T> &source)
         {
+            setSource(QList<T>(source));
+        }
+
+        // The source is handed over without touching the reference count
+        void setSource(QList<T> &&source)
+        {
+            TraceSpan span("ListModel::setSource", source.size());
+
+            if (capturing()) {
+                captureSource(source);
+            }
+
             if (m_processing) {
-                m_queue.enqueue(source);
+                // Only the latest source matters
+                m_pendingSource = std::move(source);
+                m_pending = true;
                 return;
             }
 
             m_processing = true;
 
-            auto process = [&](const QList<T> & source) {
-                if (m_source.isSharedWith(source)) {
-                    return;
-                }
+            process(std::move(source));
+
+            processQueue();
+        }
+
+        // Start a transaction of explicit changes. Example: model.edit().insert(0, item).removeKey("a").commit();
+        Editor edit() {
+            return Editor(this);
+        }
+
+        void setCustomConvertor(const std::function<QVariantMap (T, int)> &customConvertor) {
+            m_customConvertor = customConvertor;
+            if (customConvertor != nullptr) {
+                m_algo.converter = customConvertor;
+            } else {
+                m_algo.converter = [](const T& value, int index) {
+                    Q_UNUSED(index);
+                    return QImmutable::convert(value);
+                };
+            }
+        }
 
-                FastDiffRunner<T> runner;
-                if (m_customConvertor != nullptr) {
-                    runner.setCustomConvertor(m_customConvertor);
+        // See FastDiffRunner::setIdentityKeyEnabled()
+        void setIdentityKeyEnabled(bool enabled) {
+            m_algo.identityKey = enabled;
+        }
+
+        // See FastDiffRunner::setResetThreshold(). The model is reset by a single beginResetModel()
+        // instead of the fine-grained changes.
+        void setResetThreshold(qreal ratio, int minimumSize = 100) {
+            m_algo.resetRatio = ratio;
+            m_algo.resetMinimumSize = minimumSize;
+        }
+
+        // The strategy chosen by the last sync
+        DiffStrategy lastStrategy() const {
+            return m_algo.strategy();
+        }
+
+    private:
+
+        void process(QList<T>&& source) {
+            DiffStatistics statistics;
+
+            if (m_source.isSharedWith(source)) {
+                if (diffStatisticsEnabled()) {
+                    statistics.fromCount = statistics.toCount = m_source.size();
+                    statistics.sharedList = true;
+                    setDiffStatistics(statistics);
                 }
-                QList<QSPatch> patches = runner.compare(m_source, source);
-                m_source = source;
-                runner.patch(this, patches);
-            };
+                return;
+            }
 
-            process(source);
+            QList<T> prev = std::move(m_source);
+            m_source = std::move(source);
+            invalidateKeyIndex();
 
-            while (m_queue.size() > 0) {
-                QList<T> input = m_queue.dequeue();
-                process(input);
+            // The algo is kept across syncs to reuse its tables.
+            // The patches are applied to this model while they are found.
+            m_algo.statistics = diffStatisticsEnabled() ? &statistics : 0;
+            m_algo.compare(prev, m_source);
+            m_algo.reset();
+
+            if (m_algo.statistics != 0) {
+                m_algo.statistics = 0;
+                setDiffStatistics(statistics);
+            }
+        }
+
+        void processQueue() {
+            while (m_pending) {
+                // Compare with the latest source directly, so the pending updates
+                // reach the model as a single set of patches instead of transient
+                // inserts / removes cancelled by the later one.
+                QList<T> input = std::move(m_pendingSource);
+                m_pendingSource = QList<T>();
+                m_pending = false;
+                process(std::move(input));
             }
             m_processing = false;
         }
 
-        void setCustomConvertor(const std::function<QVariantMap (T, int)> &customConvertor) {
-            m_customConvertor = customConvertor;
+        void commit(const QList<T>& source, const QSPatchSet& patches) {
+            if (m_processing || m_customConvertor != nullptr) {
+                // A custom convertor may depend on the index of every item, only a full comparison is exact.
+                invalidateKeyIndex();
+                setSource(source);
+                return;
+            }
+
+            // The transaction is recorded as a source, so a replay reaches the same content
+            if (capturing()) {
+                captureSource(source);
+            }
+
+            m_processing = true;
+
+            QElapsedTimer timer;
+            if (diffStatisticsEnabled()) {
+                timer.start();
+            }
+
+            int fromCount = m_source.size();
+            FastDiffRunner<T> runner;
+            m_source = source;
+            runner.patch(this, patches);
+
+            if (diffStatisticsEnabled()) {
+                DiffStatistics statistics;
+                statistics.fromCount = fromCount;
+                statistics.toCount = m_source.size();
+                statistics.countPatches(patches);
+                statistics.applyTime = statistics.totalTime = timer.nsecsElapsed();
+                setDiffStatistics(statistics);
+            }
+
+            processQueue();
         }
 
-    private:
+        void captureSource(const QList<T>& source) {
+            QVariantList list;
+            list.reserve(source.size());
+            for (int i = 0 ; i < source.size() ; i++) {
+                list << m_algo.converter(source.at(i), i);
+            }
+            capture(list);
+        }
+
+        // Build the key to index table of the list edited by a transaction. It calls key() once per item,
+        // and it is kept until the source is replaced or an edit shifts the rows.
+        void buildKeyIndex(const QList<T>& source) {
+            if (m_keyIndexValid) {
+                return;
+            }
+
+            Item<T> wrapper;
+            m_keyIndex.clear();
+            if (wrapper.hasKey()) {
+                m_keyIndex.reserve(source.size());
+                for (int i = 0 ; i < source.size() ; i++) {
+                    m_keyIndex.insert(wrapper.key(source.at(i)), i);
+                }
+            }
+            m_keyIndexValid = true;
+        }
+
+        void invalidateKeyIndex() {
+            if (m_keyIndexValid) {
+                m_keyIndex.clear();
+                m_keyIndexValid = false;
+            }
+        }
 
         QList<T> m_source;
         std::function<QVariantMap(T, int)> m_customConvertor;
+
+        QHash<QString, int> m_keyIndex;
+        bool m_keyIndexValid;
         bool m_processing;
-        QQueue<QList<T>> m_queue;
+        FastDiffRunnerAlgo<T> m_algo;
+
+        // The source set while processing
+        QList<T> m_pendingSource;
+        bool m_pending;
 
 
     };
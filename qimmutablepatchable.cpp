@@ -0,0 +1,177 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include "qimmutablepatchable.h"
+#include "qimmutabletrace.h"
+
+using namespace QImmutable;
+
+/*! \class QImmutable::BatchPatchable
+    \inmodule QImmutable
+
+BatchPatchable extends the Patchable interface for sinks that could do better than applying
+the patches one by one. The patches applied by QSDiffRunner::patch(), FastDiffRunner::patch()
+and a FastDiffRunnerAlgo sink are wrapped by beginBatch() and endBatch(), so a sink could defer
+its notifications to the end of a batch. The payloads of insertions are passed as rvalues, and
+consecutive updates are passed to setRange().
+
+\sa Patchable
+ */
+
+static QVariantMap changesOf(const QSPatch& patch)
+{
+    QVariantMap res;
+    if (patch.data().size() > 0) {
+        res = patch.data().at(0).toMap();
+    }
+    return res;
+}
+
+// Apply a patch. batch is the patchable as a BatchPatchable, or null.
+// If take is true, the payload of an insertion is moved out of the patch.
+static void apply(Patchable *patchable, BatchPatchable* batch, QSPatch &patch, bool take)
+{
+    switch (patch.type()) {
+    case QSPatch::Remove:
+        patchable->remove(patch.from(), patch.count());
+        break;
+    case QSPatch::Insert:
+        if (batch && take) {
+            batch->insert(patch.from(), patch.takeData());
+        } else {
+            patchable->insert(patch.from(), patch.data());
+        }
+        break;
+    case QSPatch::Move:
+        patchable->move(patch.from(), patch.to(), patch.count());
+        break;
+    case QSPatch::Update:
+        patchable->set(patch.from(), changesOf(patch));
+        break;
+    case QSPatch::Reset: {
+        QVariantList data = take ? patch.takeData() : patch.data();
+        if (batch && batch->reset(std::move(data))) {
+            break;
+        }
+
+        // A sink without reset() receives the same changes as a removal and an insertion
+        if (patch.count() > 0) {
+            patchable->remove(0, patch.count());
+        }
+        if (data.isEmpty()) {
+            break;
+        } else if (batch) {
+            batch->insert(0, std::move(data));
+        } else {
+            patchable->insert(0, data);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void applyAll(Patchable *patchable, QSPatchSet &patches, bool take)
+{
+    TraceSpan span("applyPatches", patches.size());
+    BatchPatchable* batch = dynamic_cast<BatchPatchable*>(patchable);
+
+    if (!batch) {
+        for (int i = 0 ; i < patches.size() ; i++) {
+            QSPatch patch = patches.at(i);
+            apply(patchable, 0, patch, false);
+        }
+        return;
+    }
+
+    batch->beginBatch();
+
+    int i = 0;
+    while (i < patches.size()) {
+        const QSPatch& patch = patches.at(i);
+        int next = i + 1;
+
+        if (patch.type() == QSPatch::Update) {
+            while (next < patches.size() &&
+                   patches.at(next).type() == QSPatch::Update &&
+                   patches.at(next).from() == patch.from() + next - i) {
+                next++;
+            }
+        }
+
+        if (next - i > 1) {
+            QVector<QVariantMap> changes;
+            changes.reserve(next - i);
+            for (int j = i ; j < next ; j++) {
+                changes << changesOf(patches.at(j));
+            }
+            batch->setRange(patch.from(), patch.from() + next - i - 1, std::move(changes));
+        } else if (take) {
+            apply(patchable, batch, patches[i], true);
+        } else {
+            QSPatch copy = patch;
+            apply(patchable, batch, copy, false);
+        }
+
+        i = next;
+    }
+
+    batch->endBatch();
+}
+
+/*! \fn void QImmutable::applyPatch(Patchable* patchable, const QSPatch& patch)
+
+  Applies a patch to a Patchable.
+ */
+
+void QImmutable::applyPatch(Patchable *patchable, const QSPatch &patch)
+{
+    QSPatch copy = patch;
+    apply(patchable, dynamic_cast<BatchPatchable*>(patchable), copy, false);
+}
+
+/*! \fn void QImmutable::applyPatch(Patchable* patchable, QSPatch&& patch)
+
+  Applies a patch to a Patchable. If it is a BatchPatchable, the payload of an insertion is moved to it.
+ */
+
+void QImmutable::applyPatch(Patchable *patchable, QSPatch &&patch)
+{
+    apply(patchable, dynamic_cast<BatchPatchable*>(patchable), patch, true);
+}
+
+/*! \fn void QImmutable::applyPatch(Patchable* patchable, BatchPatchable* batch, QSPatch&& patch)
+
+  Same as applyPatch(), but batch is the patchable cast to a BatchPatchable by the caller, or null
+  if it is not a BatchPatchable. A caller applying patches one by one casts it only once.
+ */
+
+void QImmutable::applyPatch(Patchable *patchable, BatchPatchable *batch, QSPatch &&patch)
+{
+    apply(patchable, batch, patch, true);
+}
+
+/*! \fn void QImmutable::applyPatches(Patchable* patchable, const QSPatchSet& patches)
+
+  Applies the patches to a Patchable in order. If it is a BatchPatchable, the patches are applied
+  as a batch, and a run of update patches on consecutive items is applied by setRange().
+ */
+
+void QImmutable::applyPatches(Patchable *patchable, const QSPatchSet &patches)
+{
+    QSPatchSet copy = patches;
+    applyAll(patchable, copy, false);
+}
+
+/*! \fn void QImmutable::applyPatches(Patchable* patchable, QSPatchSet&& patches)
+
+  Same as applyPatches(), but the payloads of insertions are moved to a BatchPatchable.
+ */
+
+void QImmutable::applyPatches(Patchable *patchable, QSPatchSet &&patches)
+{
+    applyAll(patchable, patches, true);
+}
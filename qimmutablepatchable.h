@@ -2,6 +2,8 @@
 #define QSPATCHABLE
 
 #include <QVariantMap>
+#include <QVector>
+#include "qspatch.h"
 
 namespace QImmutable {
 
@@ -17,6 +19,61 @@ public:
     virtual void set(int index, QVariantMap dict) = 0;
 };
 
+/// An extended Patchable that is notified of the beginning and the end of a batch of patches,
+/// and could take the ownership of the payloads.
+/*
+ The runners check for this interface by dynamic_cast, and fall back to the Patchable
+ interface for other sinks. The default implementations forward to the Patchable interface.
+
+ set() takes the changes by value already, so the runners pass a temporary to move it in.
+ */
+class BatchPatchable : public Patchable {
+public:
+    using Patchable::insert;
+
+    // Called before the first patch of a batch is applied. Batches could be nested.
+    virtual void beginBatch() {
+    }
+
+    // Called after the last patch of a batch is applied
+    virtual void endBatch() {
+    }
+
+    // The payload is not used by the caller anymore, it could be moved into the storage.
+    virtual void insert(int index, QVariantList &&value) {
+        insert(index, static_cast<const QVariantList&>(value));
+    }
+
+    // Apply the changes to the items from first to last (inclusive). changes[i] is for the item at first + i.
+    virtual void setRange(int first, int last, QVector<QVariantMap> changes) {
+        Q_UNUSED(last);
+        for (int i = 0 ; i < changes.size() ; i++) {
+            set(first + i, changes[i]);
+        }
+    }
+
+    // Replace the whole content. Returns false if it is not supported, then the caller applies the patches instead.
+    virtual bool reset(QVariantList &&storage) {
+        Q_UNUSED(storage);
+        return false;
+    }
+};
+
+// Apply a patch to a Patchable
+void applyPatch(Patchable* patchable, const QSPatch& patch);
+
+// The payload of an insertion is moved to a BatchPatchable
+void applyPatch(Patchable* patchable, QSPatch&& patch);
+
+// Same as above, but batch is the patchable cast to a BatchPatchable (or null) by the caller,
+// so a caller applying many patches casts it once
+void applyPatch(Patchable* patchable, BatchPatchable* batch, QSPatch&& patch);
+
+// Apply patches to a Patchable. A BatchPatchable receives them as a batch, and consecutive updates as a range.
+void applyPatches(Patchable* patchable, const QSPatchSet& patches);
+
+void applyPatches(Patchable* patchable, QSPatchSet&& patches);
+
 }
 
 #endif // QSPATCHABLE
@@ -0,0 +1,464 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablepatchcodec.h"
+
+using namespace QImmutable;
+
+enum MessageKind {
+    PatchesMessage = 1,
+    SnapshotMessage = 2
+};
+
+enum ValueTag {
+    InvalidTag,
+    FalseTag,
+    TrueTag,
+    IntTag,
+    DoubleTag,
+    StringTag,
+    MapTag,
+    ListTag,
+    VariantTag
+};
+
+static void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append((char) value);
+}
+
+static quint64 zigzag(qint64 value)
+{
+    return ((quint64) value << 1) ^ (quint64) (value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return (qint64) (value >> 1) ^ -(qint64) (value & 1);
+}
+
+static void writeString(QByteArray& out, const QString& value)
+{
+    QByteArray utf8 = value.toUtf8();
+    writeVarint(out, utf8.size());
+    out.append(utf8);
+}
+
+class PatchDecoder::Reader {
+public:
+    Reader(const QByteArray& data) : data(data), pos(0) {
+    }
+
+    bool readByte(quint8& value) {
+        if (pos >= data.size()) {
+            return false;
+        }
+        value = (quint8) data.at(pos++);
+        return true;
+    }
+
+    bool readVarint(quint64& value) {
+        value = 0;
+        for (int shift = 0 ; shift < 64 ; shift += 7) {
+            quint8 byte;
+            if (!readByte(byte)) {
+                return false;
+            }
+            value |= (quint64) (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readInt(int& value) {
+        quint64 v;
+        if (!readVarint(v)) {
+            return false;
+        }
+        value = (int) (qint32) v;
+        return true;
+    }
+
+    bool readBytes(QByteArray& value) {
+        quint64 size;
+        if (!readVarint(size) || size > (quint64) (data.size() - pos)) {
+            return false;
+        }
+        value = data.mid(pos, (int) size);
+        pos += (int) size;
+        return true;
+    }
+
+    bool readString(QString& value) {
+        QByteArray bytes;
+        if (!readBytes(bytes)) {
+            return false;
+        }
+        value = QString::fromUtf8(bytes);
+        return true;
+    }
+
+    const QByteArray& data;
+    int pos;
+};
+
+/*! \class QImmutable::PatchEncoder
+    \inmodule QImmutable
+
+PatchEncoder encodes a QSPatchSet into a compact binary message to be sent to another process.
+Indexes and counts are written as varints, and field names are replaced by role ids. A field
+name is only written on its first use, so the size of a message scales with the size of the
+change instead of the size of the items.
+
+The encoder is stateful. Messages must be decoded by a PatchDecoder in the same order.
+encodeSnapshot() restarts the role table on both sides.
+
+\sa PatchDecoder, Replicator
+ */
+
+PatchEncoder::PatchEncoder()
+{
+}
+
+QByteArray PatchEncoder::encode(const QSPatchSet &patches)
+{
+    QByteArray out;
+    out.append((char) PatchesMessage);
+    writeVarint(out, patches.size());
+
+    for (int i = 0 ; i < patches.size() ; i++) {
+        const QSPatch& patch = patches.at(i);
+        QVariantList data = patch.data();
+
+        out.append((char) patch.type());
+        writeVarint(out, (quint32) patch.from());
+        writeVarint(out, (quint32) patch.to());
+        writeVarint(out, (quint32) patch.count());
+        writeVarint(out, data.size());
+
+        for (int j = 0 ; j < data.size() ; j++) {
+            writeMap(out, data.at(j).toMap());
+        }
+    }
+
+    return out;
+}
+
+QByteArray PatchEncoder::encodeSnapshot(const QVariantList &storage)
+{
+    reset();
+
+    QByteArray out;
+    out.append((char) SnapshotMessage);
+    writeVarint(out, storage.size());
+
+    for (int i = 0 ; i < storage.size() ; i++) {
+        writeMap(out, storage.at(i).toMap());
+    }
+
+    return out;
+}
+
+void PatchEncoder::reset()
+{
+    m_roles.clear();
+}
+
+void PatchEncoder::writeMap(QByteArray &out, const QVariantMap &map)
+{
+    writeVarint(out, map.size());
+
+    QMap<QString,QVariant>::const_iterator iter = map.constBegin();
+    while (iter != map.constEnd()) {
+        QHash<QString, quint32>::const_iterator role = m_roles.constFind(iter.key());
+
+        if (role == m_roles.constEnd()) {
+            // A new role is defined by the next id followed by its name
+            quint32 id = m_roles.size();
+            m_roles[iter.key()] = id;
+            writeVarint(out, id);
+            writeString(out, iter.key());
+        } else {
+            writeVarint(out, role.value());
+        }
+
+        writeValue(out, iter.value());
+        iter++;
+    }
+}
+
+void PatchEncoder::writeValue(QByteArray &out, const QVariant &value)
+{
+    switch ((int) value.type()) {
+    case QVariant::Invalid:
+        out.append((char) InvalidTag);
+        break;
+    case QVariant::Bool:
+        out.append((char) (value.toBool() ? TrueTag : FalseTag));
+        break;
+    case QVariant::Int:
+    case QVariant::LongLong:
+        out.append((char) IntTag);
+        writeVarint(out, zigzag(value.toLongLong()));
+        break;
+    case QVariant::Double:
+        {
+            // IEEE 754 bits in little endian, so the format doesn't depend on the host
+            double v = value.toDouble();
+            quint64 bits;
+            memcpy(&bits, &v, sizeof(bits));
+            uchar buffer[sizeof(bits)];
+            qToLittleEndian(bits, buffer);
+            out.append((char) DoubleTag);
+            out.append((const char*) buffer, sizeof(buffer));
+        }
+        break;
+    case QVariant::String:
+        out.append((char) StringTag);
+        writeString(out, value.toString());
+        break;
+    case QVariant::Map:
+        out.append((char) MapTag);
+        writeMap(out, value.toMap());
+        break;
+    case QVariant::List:
+        {
+            QVariantList list = value.toList();
+            out.append((char) ListTag);
+            writeVarint(out, list.size());
+            for (int i = 0 ; i < list.size() ; i++) {
+                writeValue(out, list.at(i));
+            }
+        }
+        break;
+    default:
+        {
+            QByteArray bytes;
+            QDataStream stream(&bytes, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_5_0);
+            stream << value;
+            out.append((char) VariantTag);
+            writeVarint(out, bytes.size());
+            out.append(bytes);
+        }
+        break;
+    }
+}
+
+/*! \class QImmutable::PatchDecoder
+    \inmodule QImmutable
+
+PatchDecoder decodes the messages written by PatchEncoder.
+
+\sa PatchEncoder
+ */
+
+PatchDecoder::PatchDecoder()
+{
+}
+
+/*! \fn PatchDecoder::Kind QImmutable::PatchDecoder::decode(const QByteArray &message, QSPatchSet &patches, QVariantList &storage)
+
+    Decodes a message. If it is a patch set, the result is written to patches and Patches is returned.
+    If it is a snapshot, the result is written to storage and Snapshot is returned.
+    Invalid is returned for a malformed message.
+ */
+
+PatchDecoder::Kind PatchDecoder::decode(const QByteArray &message, QSPatchSet &patches, QVariantList &storage)
+{
+    Reader reader(message);
+    quint8 kind;
+    quint64 size;
+
+    if (!reader.readByte(kind) || !reader.readVarint(size)) {
+        return Invalid;
+    }
+
+    if (kind == SnapshotMessage) {
+        reset();
+
+        QVariantList list;
+        list.reserve((int) qMin(size, (quint64) message.size()));
+
+        for (quint64 i = 0 ; i < size ; i++) {
+            QVariantMap map;
+            if (!readMap(reader, map)) {
+                return Invalid;
+            }
+            list.append(map);
+        }
+
+        storage = list;
+        return Snapshot;
+    } else if (kind != PatchesMessage) {
+        return Invalid;
+    }
+
+    QSPatchSet result;
+
+    for (quint64 i = 0 ; i < size ; i++) {
+        quint8 type;
+        int from, to, count, dataSize;
+
+        if (!reader.readByte(type) ||
+            !reader.readInt(from) ||
+            !reader.readInt(to) ||
+            !reader.readInt(count) ||
+            !reader.readInt(dataSize) ||
+            type > QSPatch::Reset) {
+            return Invalid;
+        }
+
+        QVariantList data;
+        for (int j = 0 ; j < dataSize ; j++) {
+            QVariantMap map;
+            if (!readMap(reader, map)) {
+                return Invalid;
+            }
+            data.append(map);
+        }
+
+        result << QSPatch((QSPatch::Type) type, from, to, count, data);
+    }
+
+    patches = result;
+    return Patches;
+}
+
+void PatchDecoder::reset()
+{
+    m_roles.clear();
+}
+
+bool PatchDecoder::readMap(PatchDecoder::Reader &reader, QVariantMap &map)
+{
+    quint64 size;
+    if (!reader.readVarint(size)) {
+        return false;
+    }
+
+    for (quint64 i = 0 ; i < size ; i++) {
+        quint64 id;
+        if (!reader.readVarint(id) || id > (quint64) m_roles.size()) {
+            return false;
+        }
+
+        if (id == (quint64) m_roles.size()) {
+            QString name;
+            if (!reader.readString(name)) {
+                return false;
+            }
+            m_roles << name;
+        }
+
+        QVariant value;
+        if (!readValue(reader, value)) {
+            return false;
+        }
+        map[m_roles.at((int) id)] = value;
+    }
+
+    return true;
+}
+
+bool PatchDecoder::readValue(PatchDecoder::Reader &reader, QVariant &value)
+{
+    quint8 tag;
+    if (!reader.readByte(tag)) {
+        return false;
+    }
+
+    switch (tag) {
+    case InvalidTag:
+        value = QVariant();
+        break;
+    case FalseTag:
+        value = false;
+        break;
+    case TrueTag:
+        value = true;
+        break;
+    case IntTag: {
+        quint64 v;
+        if (!reader.readVarint(v)) {
+            return false;
+        }
+        qint64 i = unzigzag(v);
+        if (i >= INT_MIN && i <= INT_MAX) {
+            value = (int) i;
+        } else {
+            value = i;
+        }
+        break;
+    }
+    case DoubleTag: {
+        double v;
+        if (reader.data.size() - reader.pos < (int) sizeof(v)) {
+            return false;
+        }
+        quint64 bits = qFromLittleEndian<quint64>((const uchar*) reader.data.constData() + reader.pos);
+        memcpy(&v, &bits, sizeof(v));
+        reader.pos += sizeof(v);
+        value = v;
+        break;
+    }
+    case StringTag: {
+        QString v;
+        if (!reader.readString(v)) {
+            return false;
+        }
+        value = v;
+        break;
+    }
+    case MapTag: {
+        QVariantMap v;
+        if (!readMap(reader, v)) {
+            return false;
+        }
+        value = v;
+        break;
+    }
+    case ListTag: {
+        quint64 size;
+        if (!reader.readVarint(size)) {
+            return false;
+        }
+        QVariantList v;
+        for (quint64 i = 0 ; i < size ; i++) {
+            QVariant item;
+            if (!readValue(reader, item)) {
+                return false;
+            }
+            v.append(item);
+        }
+        value = v;
+        break;
+    }
+    case VariantTag: {
+        QByteArray bytes;
+        if (!reader.readBytes(bytes)) {
+            return false;
+        }
+        QDataStream stream(bytes);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream >> value;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    return true;
+}
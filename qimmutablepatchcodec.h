@@ -0,0 +1,64 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include "qspatch.h"
+
+namespace QImmutable {
+
+/// Encode patch sets into a compact binary message.
+/*
+ Indexes are written as varints. Field names are replaced by role ids, a name
+ is written once on its first use. Therefore, a PatchEncoder must be paired with
+ a PatchDecoder that decodes every message in the same order.
+ */
+class PatchEncoder {
+public:
+    PatchEncoder();
+
+    QByteArray encode(const QSPatchSet& patches);
+
+    // Encode the whole list. The role table is restarted, so it could be decoded by a reset decoder.
+    QByteArray encodeSnapshot(const QVariantList& storage);
+
+    void reset();
+
+private:
+    void writeMap(QByteArray& out, const QVariantMap& map);
+    void writeValue(QByteArray& out, const QVariant& value);
+
+    QHash<QString, quint32> m_roles;
+};
+
+class PatchDecoder {
+public:
+    enum Kind {
+        Invalid,
+        Patches,
+        Snapshot
+    };
+
+    PatchDecoder();
+
+    // Decode a message from PatchEncoder. The result is written to patches or storage according to the kind.
+    Kind decode(const QByteArray& message, QSPatchSet& patches, QVariantList& storage);
+
+    void reset();
+
+private:
+    class Reader;
+
+    bool readMap(Reader& reader, QVariantMap& map);
+    bool readValue(Reader& reader, QVariant& value);
+
+    QStringList m_roles;
+};
+
+}
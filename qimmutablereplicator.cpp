@@ -0,0 +1,355 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablereplicator.h"
+#include "qsdiffrunner.h"
+#include "priv/qimmutablelistpatcher_p.h"
+
+using namespace QImmutable;
+
+// A message sent from a Replica to its Replicator. It could not be confused with
+// a message of PatchEncoder as it is never sent in that direction.
+enum ControlMessage {
+    ResyncRequest = 1
+};
+
+static void writeFrameSize(QByteArray& out, quint32 size)
+{
+    while (size >= 0x80) {
+        out.append((char) ((size & 0x7f) | 0x80));
+        size >>= 7;
+    }
+    out.append((char) size);
+}
+
+// Returns the size of the frame header, 0 if it is incomplete, or -1 if it is malformed
+static int readFrameSize(const QByteArray& data, quint32& size)
+{
+    size = 0;
+    for (int i = 0 ; i < 5 ; i++) {
+        if (i >= data.size()) {
+            return 0;
+        }
+        quint8 byte = (quint8) data.at(i);
+        size |= (quint32) (byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/*! \class QImmutable::Replicator
+    \inmodule QImmutable
+
+Replicator mirrors a list to a Replica in another process. It implements the Patchable interface,
+so the patches applied on a model could be applied to a Replicator, and they are streamed to the
+replica by PatchEncoder. The bandwidth and the CPU usage on both sides scale with the size of a
+change instead of the size of the list.
+
+Every message is prefixed with its size as a varint. The patches applied by the Patchable interface
+are sent together on the next event loop turn. Call send() to send a patch set immediately.
+
+A snapshot of the list is sent whenever a device is set, so a replica that has just connected
+is resynced. If the device is readable, a resync request from the replica is answered by a snapshot too.
+
+\sa Replica
+ */
+
+Replicator::Replicator(QObject *parent) : QObject(parent)
+{
+    m_flushScheduled = false;
+}
+
+QIODevice *Replicator::device() const
+{
+    return m_device;
+}
+
+void Replicator::setDevice(QIODevice *device)
+{
+    flush();
+
+    if (!m_device.isNull()) {
+        m_device->disconnect(this);
+    }
+
+    m_device = device;
+    m_input.clear();
+
+    if (!m_device.isNull() && m_device->isReadable()) {
+        connect(m_device.data(), SIGNAL(readyRead()), this, SLOT(readRequests()));
+    }
+
+    sendSnapshot();
+}
+
+QVariantList Replicator::storage() const
+{
+    return m_storage;
+}
+
+void Replicator::setStorage(const QVariantList &storage)
+{
+    flush();
+    m_storage = storage;
+    sendSnapshot();
+}
+
+void Replicator::send(const QSPatchSet &patches)
+{
+    flush();
+
+    ListPatcher patcher(m_storage);
+    for (int i = 0 ; i < patches.size() ; i++) {
+        patcher.patch(patches.at(i));
+    }
+
+    if (!m_device.isNull()) {
+        write(m_encoder.encode(patches));
+    }
+}
+
+void Replicator::insert(int index, const QVariantList &value)
+{
+    enqueue(QSPatch(QSPatch::Insert, index, index + value.size() - 1, value.size(), value));
+}
+
+void Replicator::move(int from, int to, int count)
+{
+    enqueue(QSPatch(QSPatch::Move, from, to, count));
+}
+
+void Replicator::remove(int i, int count)
+{
+    enqueue(QSPatch::createRemove(i, i + count - 1));
+}
+
+void Replicator::set(int index, QVariantMap dict)
+{
+    enqueue(QSPatch::createUpdate(index, dict));
+}
+
+void Replicator::flush()
+{
+    m_flushScheduled = false;
+
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    QSPatchSet patches = m_pending;
+    m_pending.clear();
+
+    if (!m_device.isNull()) {
+        write(m_encoder.encode(patches));
+    }
+}
+
+void Replicator::readRequests()
+{
+    if (m_device.isNull()) {
+        return;
+    }
+
+    m_input.append(m_device->readAll());
+
+    bool resync = false;
+    int pos = 0;
+    while (pos < m_input.size()) {
+        quint32 size;
+        int header = readFrameSize(m_input.mid(pos, 5), size);
+
+        if (header < 0) {
+            m_input.clear();
+            return;
+        } else if (header == 0 || (quint32) (m_input.size() - pos - header) < size) {
+            break;
+        }
+
+        if (size == 1 && m_input.at(pos + header) == (char) ResyncRequest) {
+            resync = true;
+        }
+        pos += header + size;
+    }
+
+    m_input.remove(0, pos);
+
+    if (resync) {
+        flush();
+        sendSnapshot();
+    }
+}
+
+void Replicator::enqueue(const QSPatch &patch)
+{
+    ListPatcher patcher(m_storage);
+    patcher.patch(patch);
+
+    if (m_device.isNull()) {
+        return;
+    }
+
+    m_pending << patch;
+
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void Replicator::sendSnapshot()
+{
+    if (m_device.isNull()) {
+        return;
+    }
+    write(m_encoder.encodeSnapshot(m_storage));
+}
+
+void Replicator::write(const QByteArray &message)
+{
+    QByteArray frame;
+    frame.reserve(message.size() + 5);
+    writeFrameSize(frame, message.size());
+    frame.append(message);
+    m_device->write(frame);
+}
+
+/*! \class QImmutable::Replica
+    \inmodule QImmutable
+
+Replica receives the messages sent by a Replicator and applies them to its model.
+A snapshot replaces the content of the model by a reset, and a patch set is applied
+by QSDiffRunner::patch(), so views receive fine-grained insert, remove, move and data changed signals.
+The synced() signal is emitted after each message is applied.
+
+A patch set is only valid for the list it was computed on. After a malformed message, the replica
+becomes desynced and drops every patch set until the next snapshot, instead of applying them to a
+model that has missed a change. A resync request is sent to the Replicator if the device is writable.
+Otherwise, the host should watch the desynced property and set the device of the Replicator again.
+
+\sa Replicator
+ */
+
+Replica::Replica(QObject *parent) : QObject(parent)
+{
+    m_model = new VariantListModel(this);
+    m_desynced = false;
+}
+
+QIODevice *Replica::device() const
+{
+    return m_device;
+}
+
+void Replica::setDevice(QIODevice *device)
+{
+    if (!m_device.isNull()) {
+        m_device->disconnect(this);
+    }
+
+    m_device = device;
+    m_buffer.clear();
+    m_decoder.reset();
+    setDesynced(false);
+
+    if (!m_device.isNull()) {
+        connect(m_device.data(), SIGNAL(readyRead()), this, SLOT(read()));
+        read();
+    }
+}
+
+QObject *Replica::model() const
+{
+    return m_model;
+}
+
+bool Replica::desynced() const
+{
+    return m_desynced;
+}
+
+void Replica::requestResync()
+{
+    if (m_device.isNull() || !m_device->isWritable()) {
+        return;
+    }
+
+    QByteArray frame;
+    writeFrameSize(frame, 1);
+    frame.append((char) ResyncRequest);
+    m_device->write(frame);
+}
+
+void Replica::read()
+{
+    if (m_device.isNull()) {
+        return;
+    }
+
+    m_buffer.append(m_device->readAll());
+
+    int pos = 0;
+    while (pos < m_buffer.size()) {
+        quint32 size;
+        int header = readFrameSize(m_buffer.mid(pos, 5), size);
+
+        if (header < 0) {
+            qWarning() << "Replica: Malformed frame. Waiting for resync";
+            m_buffer.clear();
+            setDesynced(true);
+            return;
+        } else if (header == 0 || (quint32) (m_buffer.size() - pos - header) < size) {
+            break;
+        }
+
+        if (!process(m_buffer.mid(pos + header, size))) {
+            qWarning() << "Replica: Malformed message. Waiting for resync";
+            setDesynced(true);
+        }
+        pos += header + size;
+    }
+
+    m_buffer.remove(0, pos);
+}
+
+bool Replica::process(const QByteArray &message)
+{
+    QSPatchSet patches;
+    QVariantList storage;
+
+    PatchDecoder::Kind kind = m_decoder.decode(message, patches, storage);
+
+    if (kind == PatchDecoder::Snapshot) {
+        m_model->setStorage(storage);
+        setDesynced(false);
+    } else if (kind == PatchDecoder::Patches) {
+        if (m_desynced) {
+            return true;
+        }
+        QSDiffRunner runner;
+        runner.patch(m_model, patches);
+    } else {
+        return false;
+    }
+
+    emit synced();
+    return true;
+}
+
+void Replica::setDesynced(bool value)
+{
+    if (m_desynced == value) {
+        return;
+    }
+
+    m_desynced = value;
+    emit desyncedChanged();
+
+    if (m_desynced) {
+        requestResync();
+    }
+}
@@ -0,0 +1,132 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QIODevice>
+#include "qimmutablepatchable.h"
+#include "qimmutablepatchcodec.h"
+#include "qimmutablevariantlistmodel.h"
+
+namespace QImmutable {
+
+/// Streams the patches applied on it to a Replica over a QIODevice (e.g QLocalSocket).
+/*
+ Example:
+
+    // Source process
+    Replicator replicator;
+    replicator.setDevice(socket);
+
+    QSPatchSet patches = runner.compare(model.storage(), list);
+    runner.patch(&model, patches);
+    replicator.send(patches);
+
+    // Renderer process
+    Replica replica;
+    replica.setDevice(socket);
+    view->setModel(replica.model());
+
+ */
+class Replicator : public QObject, public Patchable
+{
+    Q_OBJECT
+public:
+    explicit Replicator(QObject *parent = 0);
+
+    QIODevice *device() const;
+
+    // Set the connection. A snapshot of the current list is sent to resync the replica.
+    // A resync request from the replica is answered by another snapshot.
+    void setDevice(QIODevice *device);
+
+    QVariantList storage() const;
+
+    // Replace the content and resync the replica
+    void setStorage(const QVariantList& storage);
+
+    // Send the patches as a single message
+    void send(const QSPatchSet& patches);
+
+    virtual void insert(int index, const QVariantList &value);
+
+    virtual void move(int from, int to, int count);
+
+    virtual void remove(int i , int count = 1);
+
+    virtual void set(int index, QVariantMap dict);
+
+public slots:
+
+    // Send the patches queued by the Patchable interface
+    void flush();
+
+private slots:
+    void readRequests();
+
+private:
+    void enqueue(const QSPatch& patch);
+
+    void sendSnapshot();
+
+    void write(const QByteArray& message);
+
+    QPointer<QIODevice> m_device;
+    PatchEncoder m_encoder;
+    QByteArray m_input;
+
+    // A mirror of the replica for resync
+    QVariantList m_storage;
+
+    QSPatchSet m_pending;
+    bool m_flushScheduled;
+};
+
+/// Receives the patches from a Replicator and applies them to a VariantListModel.
+class Replica : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject* model READ model CONSTANT)
+    Q_PROPERTY(bool desynced READ desynced NOTIFY desyncedChanged)
+
+public:
+    explicit Replica(QObject *parent = 0);
+
+    QIODevice *device() const;
+
+    void setDevice(QIODevice *device);
+
+    QObject* model() const;
+
+    // True after a malformed message until the next snapshot. Patches are dropped meanwhile.
+    bool desynced() const;
+
+signals:
+    void synced();
+
+    void desyncedChanged();
+
+public slots:
+    void read();
+
+    // Ask the Replicator for a snapshot. It is sent automatically when the replica is desynced.
+    void requestResync();
+
+private:
+    bool process(const QByteArray& message);
+
+    void setDesynced(bool value);
+
+    QPointer<QIODevice> m_device;
+    PatchDecoder m_decoder;
+    QByteArray m_buffer;
+    VariantListModel* m_model;
+    bool m_desynced;
+};
+
+}
@@ -0,0 +1,90 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutablesnapshot.h"
+#include "qsdiffrunner.h"
+
+using namespace QImmutable;
+
+/*! \class QImmutable::Snapshot
+    \inmodule QImmutable
+
+Snapshot is an immutable version of the storage of a VariantListModel.
+It is obtained by VariantListModel::snapshot(), which may be called from any thread.
+
+A snapshot shares the storage with the model by implicit sharing, taking one
+costs a reference count increment only. The model never modifies a published
+storage in place, the first change after publishing detaches its own copy.
+Therefore, a reader holding a snapshot always sees a consistent view, and it never
+blocks the model's thread.
+
+The version is increased on every publish. Two snapshots of the same model could be
+compared by diff() to get the patches in between.
+ */
+
+Snapshot::Snapshot() : m_version(0)
+{
+}
+
+Snapshot::Snapshot(quint64 version, const QVariantList &storage) : m_version(version), m_storage(storage)
+{
+}
+
+/*! \fn bool QImmutable::Snapshot::isNull() const
+
+    Returns true if it is not published by any model.
+ */
+
+bool Snapshot::isNull() const
+{
+    return m_version == 0;
+}
+
+/*! \fn quint64 QImmutable::Snapshot::version() const
+
+    Returns the version of this snapshot. A later snapshot of the same model has a greater version.
+ */
+
+quint64 Snapshot::version() const
+{
+    return m_version;
+}
+
+QVariantList Snapshot::storage() const
+{
+    return m_storage;
+}
+
+int Snapshot::count() const
+{
+    return m_storage.size();
+}
+
+/*! \fn QVariantMap QImmutable::Snapshot::get(int index) const
+
+    Returns the item at index. If index is out of range, an empty map is returned.
+ */
+
+QVariantMap Snapshot::get(int index) const
+{
+    if (index < 0 || index >= m_storage.size()) {
+        return QVariantMap();
+    }
+    return m_storage.at(index).toMap();
+}
+
+/*! \fn QSPatchSet QImmutable::Snapshot::diff(const Snapshot &other, const QString &keyField) const
+
+    Returns the patches that transform this snapshot to other. It is the same as
+    QSDiffRunner::compare() with keyField. It could be run on any thread.
+ */
+
+QSPatchSet Snapshot::diff(const Snapshot &other, const QString &keyField) const
+{
+    QSDiffRunner runner;
+    runner.setKeyField(keyField);
+    return runner.compare(m_storage, other.m_storage);
+}
@@ -0,0 +1,55 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QVariantList>
+#include <QMetaType>
+#include "qspatch.h"
+
+namespace QImmutable {
+
+/// An immutable version of the storage of a VariantListModel.
+/*
+ A Snapshot only holds a reference to the implicitly shared storage, so it is
+ cheap to copy and it is safe to read from any thread.
+
+ Example:
+
+    // Worker thread
+    Snapshot snapshot = model->snapshot();
+    for (int i = 0 ; i < snapshot.count() ; i++) {
+        exporter.write(snapshot.get(i));
+    }
+
+ */
+class Snapshot {
+public:
+    Snapshot();
+
+    Snapshot(quint64 version, const QVariantList& storage);
+
+    bool isNull() const;
+
+    quint64 version() const;
+
+    QVariantList storage() const;
+
+    int count() const;
+
+    QVariantMap get(int index) const;
+
+    // Returns the patches that transform this snapshot to other
+    QSPatchSet diff(const Snapshot& other, const QString& keyField = QString()) const;
+
+private:
+    quint64 m_version;
+    QVariantList m_storage;
+};
+
+}
+
+Q_DECLARE_METATYPE(QImmutable::Snapshot)
@@ -0,0 +1,171 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+#include <QStringList>
+#include <functional>
+#include "qimmutablefastdiffrunner.h"
+#include "qimmutablefunctions.h"
+
+namespace QImmutable {
+
+/// Compare a source once and apply the result to multiple Patchable sinks.
+/*
+ Example:
+
+    SyncHub<Card> hub;
+    hub.addSink(&mainModel);
+    hub.addSink(&minimapModel, QStringList() << "id" << "color");
+    hub.addSink(&aggregator);
+
+    hub.setSource(cards);
+
+ A sink is expected to be empty when it is added. The current content of the hub
+ will be inserted to it.
+ */
+template <typename T>
+class SyncHub {
+public:
+    SyncHub() {
+    }
+
+    QList<T> source() const {
+        return m_source;
+    }
+
+    void setSource(const QList<T>& source) {
+        if (m_source.isSharedWith(source)) {
+            return;
+        }
+
+        FastDiffRunner<T> runner;
+        if (m_customConvertor != nullptr) {
+            runner.setCustomConvertor(m_customConvertor);
+        }
+        QSPatchSet patches = runner.compare(m_source, source);
+        m_source = source;
+
+        if (patches.isEmpty()) {
+            return;
+        }
+
+        for (int i = 0 ; i < m_sinks.size() ; i++) {
+            dispatch(m_sinks.at(i), patches);
+        }
+    }
+
+    // Add a sink that receives the patches as they are
+    void addSink(Patchable* sink) {
+        add(Sink(sink));
+    }
+
+    // Add a sink that receives only the fields listed
+    void addSink(Patchable* sink, const QStringList& fields) {
+        Sink item(sink);
+        item.fields = fields;
+        add(item);
+    }
+
+    // Add a sink with its own convertor. It is called for inserted and updated items only.
+    void addSink(Patchable* sink, const std::function<QVariantMap(T, int)>& convertor) {
+        Sink item(sink);
+        item.convertor = convertor;
+        add(item);
+    }
+
+    void removeSink(Patchable* sink) {
+        for (int i = m_sinks.size() - 1 ; i >= 0 ; i--) {
+            if (m_sinks.at(i).sink == sink) {
+                m_sinks.removeAt(i);
+            }
+        }
+    }
+
+    int sinkCount() const {
+        return m_sinks.size();
+    }
+
+    void setCustomConvertor(const std::function<QVariantMap (T, int)> &customConvertor) {
+        m_customConvertor = customConvertor;
+    }
+
+private:
+    class Sink {
+    public:
+        Sink(Patchable* sink = 0) : sink(sink) {
+        }
+
+        Patchable* sink;
+        QStringList fields;
+        std::function<QVariantMap(T, int)> convertor;
+    };
+
+    void add(const Sink& sink) {
+        m_sinks << sink;
+
+        if (m_source.isEmpty()) {
+            return;
+        }
+
+        // Bring the new sink to the current state
+        FastDiffRunner<T> runner;
+        if (m_customConvertor != nullptr) {
+            runner.setCustomConvertor(m_customConvertor);
+        }
+        dispatch(sink, runner.compare(QList<T>(), m_source));
+    }
+
+    void dispatch(const Sink& sink, const QSPatchSet& patches) const {
+        FastDiffRunner<T> runner;
+
+        if (sink.fields.isEmpty() && sink.convertor == nullptr) {
+            runner.patch(sink.sink, patches);
+            return;
+        }
+
+        // Only the payloads are adapted. The positions are shared by all the sinks.
+        QSPatchSet adapted;
+        adapted.reserve(patches.size());
+
+        for (int i = 0 ; i < patches.size() ; i++) {
+            QSPatch patch = patches.at(i);
+
+            if (patch.type() == QSPatch::Insert) {
+                QVariantList data = patch.data();
+                for (int j = 0 ; j < data.size() ; j++) {
+                    data[j] = adapt(sink, data.at(j).toMap(), patch.from() + j);
+                }
+                patch.setData(data);
+            } else if (patch.type() == QSPatch::Update) {
+                QVariantList data = patch.data();
+                QVariantMap diff = adapt(sink, data.size() > 0 ? data.at(0).toMap() : QVariantMap(), patch.from());
+                if (diff.isEmpty()) {
+                    continue;
+                }
+                patch.setData(diff);
+            }
+            adapted << patch;
+        }
+
+        runner.patch(sink.sink, adapted);
+    }
+
+    // An inserted / updated item is at its final position in m_source
+    QVariantMap adapt(const Sink& sink, const QVariantMap& value, int index) const {
+        if (sink.convertor != nullptr) {
+            // Patchable::set() only applies the changed values of a full item
+            return sink.convertor(m_source.at(index), index);
+        }
+
+        return QImmutable::pick(value, sink.fields);
+    }
+
+    QList<T> m_source;
+    QList<Sink> m_sinks;
+    std::function<QVariantMap(T, int)> m_customConvertor;
+};
+
+}
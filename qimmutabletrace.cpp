@@ -0,0 +1,206 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "qimmutabletrace.h"
+
+// Only warnings are enabled by default, so the spans are not recorded unless it is turned on
+Q_LOGGING_CATEGORY(QImmutable::qimmutableTrace, "qimmutable.trace", QtWarningMsg)
+
+using namespace QImmutable;
+
+namespace {
+
+class TraceEvent {
+public:
+    const char* name;
+    qint64 start;
+    qint64 duration;
+    quintptr thread;
+    int count;
+
+    // -1 if it is not a diff phase
+    int converterCalls;
+    qint64 converterTime;
+};
+
+class TraceBuffer {
+public:
+    TraceBuffer() {
+        capacity = 100000;
+        next = 0;
+        wrapped = false;
+        clock.start();
+    }
+
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    int capacity;
+    int next;
+    bool wrapped;
+    QElapsedTimer clock;
+};
+
+}
+
+Q_GLOBAL_STATIC(TraceBuffer, buffer)
+
+static void saveOnExit()
+{
+    Trace::save(QString::fromLocal8Bit(qgetenv("QIMMUTABLE_TRACE_FILE")));
+}
+
+/*! \class QImmutable::Trace
+    \inmodule QImmutable
+
+Trace keeps the spans of the sync pipeline, e.g ListModel::setSource(), the phases of a comparison
+with the no. and the time of their converter calls, the patches applied and the signal batches of a model. They are exported
+in the Chrome trace event format by toJson() or save(), and could be opened by chrome://tracing or
+Perfetto to see where the sync overlaps with the QML rendering.
+
+It is turned on at runtime by the "qimmutable.trace" logging category:
+
+\code
+QT_LOGGING_RULES="qimmutable.trace.debug=true"
+\endcode
+
+If the QIMMUTABLE_TRACE_FILE environment variable is set, the trace is saved to the file on exit.
+
+A disabled trace point only reads an atomic flag, so it is kept in production builds.
+
+\sa TraceSpan
+ */
+
+qint64 Trace::now()
+{
+    return buffer()->clock.nsecsElapsed();
+}
+
+static void appendEvent(const TraceEvent& event);
+
+void Trace::record(const char *name, qint64 start, qint64 end, int count)
+{
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    event.thread = (quintptr) QThread::currentThreadId();
+    event.count = count;
+    event.converterCalls = -1;
+    event.converterTime = 0;
+    appendEvent(event);
+}
+
+void Trace::record(const char *name, qint64 start, qint64 end, int converterCalls, qint64 converterTime)
+{
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    event.thread = (quintptr) QThread::currentThreadId();
+    event.count = -1;
+    event.converterCalls = converterCalls;
+    event.converterTime = converterTime;
+    appendEvent(event);
+}
+
+static void appendEvent(const TraceEvent& event)
+{
+    static bool saveRegistered = false;
+
+    TraceBuffer* b = buffer();
+    QMutexLocker locker(&b->mutex);
+
+    if (!saveRegistered) {
+        saveRegistered = true;
+        if (qEnvironmentVariableIsSet("QIMMUTABLE_TRACE_FILE")) {
+            qAddPostRoutine(saveOnExit);
+        }
+    }
+
+    if (b->capacity <= 0) {
+        return;
+    }
+
+    if (b->events.size() < b->capacity) {
+        b->events.append(event);
+    } else {
+        b->events[b->next] = event;
+        b->wrapped = true;
+    }
+    b->next = (b->next + 1) % b->capacity;
+}
+
+void Trace::setCapacity(int capacity)
+{
+    TraceBuffer* b = buffer();
+    QMutexLocker locker(&b->mutex);
+    b->capacity = capacity;
+    b->events.clear();
+    b->next = 0;
+    b->wrapped = false;
+}
+
+void Trace::clear()
+{
+    TraceBuffer* b = buffer();
+    QMutexLocker locker(&b->mutex);
+    b->events.clear();
+    b->next = 0;
+    b->wrapped = false;
+}
+
+QByteArray Trace::toJson()
+{
+    TraceBuffer* b = buffer();
+    QMutexLocker locker(&b->mutex);
+
+    QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray out;
+    out.reserve(b->events.size() * 100 + 64);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    // The oldest span is at next if the buffer is wrapped
+    int first = b->wrapped ? b->next : 0;
+
+    for (int i = 0 ; i < b->events.size() ; i++) {
+        const TraceEvent& event = b->events.at((first + i) % b->events.size());
+
+        if (i > 0) {
+            out.append(',');
+        }
+
+        // The time unit of the format is microsecond
+        out.append("{\"name\":\"").append(event.name)
+           .append("\",\"cat\":\"qimmutable\",\"ph\":\"X\",\"ts\":")
+           .append(QByteArray::number(event.start / 1000.0, 'f', 3))
+           .append(",\"dur\":").append(QByteArray::number(event.duration / 1000.0, 'f', 3))
+           .append(",\"pid\":").append(pid)
+           .append(",\"tid\":").append(QByteArray::number((quint64) event.thread));
+
+        if (event.count >= 0) {
+            out.append(",\"args\":{\"count\":").append(QByteArray::number(event.count)).append('}');
+        } else if (event.converterCalls >= 0) {
+            out.append(",\"args\":{\"converterCalls\":").append(QByteArray::number(event.converterCalls))
+               .append(",\"converterMs\":").append(QByteArray::number(event.converterTime / 1e6, 'f', 3))
+               .append('}');
+        }
+        out.append('}');
+    }
+
+    out.append("]}");
+    return out;
+}
+
+bool Trace::save(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(qimmutableTrace) << "Trace::save() - Failed to open" << fileName;
+        return false;
+    }
+    file.write(toJson());
+    return true;
+}
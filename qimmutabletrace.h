@@ -0,0 +1,71 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QLoggingCategory>
+#include <QByteArray>
+
+namespace QImmutable {
+
+// Enable it by QT_LOGGING_RULES="qimmutable.trace.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(qimmutableTrace)
+
+/// A buffer of the spans of the sync pipeline. It is exported in the Chrome trace event format,
+/// so it could be opened by chrome://tracing or Perfetto next to a QML profiler trace.
+class Trace {
+public:
+    // It only reads an atomic flag of the logging category
+    static inline bool isEnabled() {
+        return qimmutableTrace().isDebugEnabled();
+    }
+
+    // The time since the first span in ns
+    static qint64 now();
+
+    // Record a span. The name must be a string literal. A negative count is not written.
+    static void record(const char* name, qint64 start, qint64 end, int count = -1);
+
+    // Record a span of a diff phase with the no. of converter calls and their time in it
+    static void record(const char* name, qint64 start, qint64 end, int converterCalls, qint64 converterTime);
+
+    // The no. of spans kept. The oldest spans are dropped if it is full. (Default: 100000)
+    static void setCapacity(int capacity);
+
+    static void clear();
+
+    // The recorded spans in the Chrome trace event format
+    static QByteArray toJson();
+
+    static bool save(const QString& fileName);
+};
+
+/// Record the lifetime of the object as a span if tracing is enabled
+class TraceSpan {
+public:
+    explicit inline TraceSpan(const char* name, int count = -1) : m_name(name), m_count(count) {
+        m_start = Trace::isEnabled() ? Trace::now() : -1;
+    }
+
+    inline ~TraceSpan() {
+        if (m_start >= 0) {
+            Trace::record(m_name, m_start, Trace::now(), m_count);
+        }
+    }
+
+    void setCount(int count) {
+        m_count = count;
+    }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char* m_name;
+    int m_count;
+    qint64 m_start;
+};
+
+}
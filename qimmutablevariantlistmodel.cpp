@@ -4,7 +4,10 @@
    Web: https://github.com/benlau/qsyncable
 */
 #include <QtCore>
+#include <algorithm>
 #include "qimmutablevariantlistmodel.h"
+#include "priv/qimmutablelistpatcher_p.h"
+#include "qimmutabletrace.h"
 
 using namespace QImmutable;
 
@@ -50,6 +53,13 @@ and it will emit insert, remove, move and data changed signals according to the
 VariantListModel::VariantListModel(QObject *parent) :
     QAbstractListModel(parent)
 {
+    m_snapshotEnabled = false;
+    m_snapshotPending = false;
+    m_version = 0;
+    m_batchDepth = 0;
+    m_countChanged = false;
+    m_batchTraceStart = -1;
+    m_diffStatisticsEnabled = false;
 }
 
 /*! \fn int QSListModel::rowCount(const QModelIndex &parent) const
@@ -99,7 +109,8 @@ void VariantListModel::append(const QVariantMap &value)
     beginInsertRows(QModelIndex(),m_storage.size(),m_storage.size());
     m_storage.append(value);
     endInsertRows();
-    emit countChanged();
+    notifyCountChanged();
+    schedulePublish();
 }
 
 /*! \fn  void QSListModel::insert(int index,const QVariantMap& value);
@@ -116,7 +127,8 @@ void VariantListModel::insert(int index, const QVariantMap &value)
     beginInsertRows(QModelIndex(), index, index);
     m_storage.insert(index, value);
     endInsertRows();
-    emit countChanged();
+    notifyCountChanged();
+    schedulePublish();
 }
 
 /*! \fn void QSListModel::insert(int index, const QVariantList &value)
@@ -159,7 +171,47 @@ void VariantListModel::insert(int index, const QVariantList &value)
     }
 
     endInsertRows();
-    emit countChanged();
+    notifyCountChanged();
+    schedulePublish();
+}
+
+/*! \fn void QImmutable::VariantListModel::insert(int index, QVariantList &&value)
+
+    Inserts the items at index position. The items are moved into the storage instead of being copied.
+ */
+void VariantListModel::insert(int index, QVariantList &&value)
+{
+    if (value.count() == 0) {
+        return;
+    }
+
+    if (m_roles.isEmpty()) {
+        setRoleNames(value.at(0).toMap());
+    }
+
+    int count = value.count();
+
+    beginInsertRows(QModelIndex(), index, index + count - 1);
+
+    if (m_storage.isEmpty()) {
+        m_storage = std::move(value);
+    } else {
+        m_storage.reserve(m_storage.count() + count);
+
+        // Append the new items, then rotate them into position
+        for (int i = 0 ; i < count ; i++) {
+            m_storage.append(QVariant());
+            m_storage.last().swap(value[i]);
+        }
+
+        if (index < m_storage.size() - count) {
+            std::rotate(m_storage.begin() + index, m_storage.end() - count, m_storage.end());
+        }
+    }
+
+    endInsertRows();
+    notifyCountChanged();
+    schedulePublish();
 }
 
 /*! \fn void QSListModel::move(int from, int to, int n)
@@ -210,6 +262,7 @@ void VariantListModel::move(int from, int to, int count)
     }
 
     endMoveRows();
+    schedulePublish();
 }
 
 /*! \fn void QSListModel::clear()
@@ -226,7 +279,8 @@ void VariantListModel::clear()
     beginRemoveRows(QModelIndex(), 0, m_storage.count() - 1);
     m_storage.clear();
     endRemoveRows();
-    emit countChanged();
+    notifyCountChanged();
+    schedulePublish();
 
 }
 
@@ -245,7 +299,8 @@ void VariantListModel::remove(int i, int count)
         m_storage.removeAt(i);
     }
     endRemoveRows();
-    emit countChanged();
+    notifyCountChanged();
+    schedulePublish();
 }
 
 /*! \property QSListModel::count
@@ -308,6 +363,7 @@ void VariantListModel::setProperty(int idx, QString property, QVariant value)
     emit dataChanged(index(idx,0),
                      index(idx,0),
                      roles);
+    schedulePublish();
 }
 
 void VariantListModel::set(int idx, QVariantMap data)
@@ -322,15 +378,84 @@ void VariantListModel::set(int idx, QVariantMap data)
     }
 
     QVector<int> roles;
+    QStringList nested;
 
-    QVariantMap original = get(idx);
+    merge(idx, data, roles, nested);
 
-    QMapIterator<QString, QVariant> iter(data);
+    // A child model following the field applies the sub-patches before the row is reported as changed
+    for (int i = 0 ; i < nested.size() ; i++) {
+        emit nestedPatchApplied(idx, nested.at(i), data.value(nested.at(i)).value<QSPatchSet>());
+    }
+
+    emit dataChanged(index(idx,0),
+                     index(idx,0),
+                     roles);
+    schedulePublish();
+}
+
+/*! \fn void QImmutable::VariantListModel::setRange(int first, int last, QVector<QVariantMap> changes)
+
+    Applies changes[i] to the item at first + i, and emits a single dataChanged() signal for the range
+    with the union of the changed roles.
+ */
+
+void VariantListModel::setRange(int first, int last, QVector<QVariantMap> changes)
+{
+    if (first < 0 || last >= m_storage.size() || last - first + 1 != changes.size()) {
+        // Including an append
+        BatchPatchable::setRange(first, last, changes);
+        return;
+    }
+
+    QVector<int> roles;
+    QVector<QStringList> nested(changes.size());
+
+    for (int i = 0 ; i < changes.size() ; i++) {
+        QVector<int> itemRoles;
+        merge(first + i, changes.at(i), itemRoles, nested[i]);
+
+        for (int j = 0 ; j < itemRoles.size() ; j++) {
+            if (!roles.contains(itemRoles.at(j))) {
+                roles << itemRoles.at(j);
+            }
+        }
+    }
+
+    for (int i = 0 ; i < nested.size() ; i++) {
+        for (int j = 0 ; j < nested.at(i).size() ; j++) {
+            const QString& field = nested.at(i).at(j);
+            emit nestedPatchApplied(first + i, field, changes.at(i).value(field).value<QSPatchSet>());
+        }
+    }
+
+    emit dataChanged(index(first,0),
+                     index(last,0),
+                     roles);
+    schedulePublish();
+}
+
+void VariantListModel::merge(int idx, const QVariantMap &changes, QVector<int> &roles, QStringList &nested)
+{
+    // Take the item out of the storage, so the changes don't detach a copy of it
+    QVariantMap original = m_storage.at(idx).toMap();
+    m_storage[idx] = QVariant();
+
+    QMapIterator<QString, QVariant> iter(changes);
 
     while (iter.hasNext()) {
         iter.next();
-        if (!original.contains(iter.key()) ||
-             original[iter.key()] != iter.value()) {
+        QMap<QString, QVariant>::const_iterator orig = original.constFind(iter.key());
+
+        if (iter.value().userType() == qMetaTypeId<QSPatchSet>()) {
+            // A sub-diff of a list field
+            original[iter.key()] = ListPatcher::value(original.value(iter.key()), iter.value());
+            nested << iter.key();
+
+            if (m_rolesLookup.contains(iter.key())) {
+                roles << m_rolesLookup[iter.key()];
+            }
+        } else if (orig == original.constEnd() ||
+            !fastCompare(orig.value(), iter.value())) {
 
             if (m_rolesLookup.contains(iter.key())) {
                 roles << m_rolesLookup[iter.key()];
@@ -341,10 +466,6 @@ void VariantListModel::set(int idx, QVariantMap data)
     }
 
     m_storage[idx] = original;
-
-    emit dataChanged(index(idx,0),
-                     index(idx,0),
-                     roles);
 }
 
 /*! \fn QHash<int, QByteArray> QSListModel::roleNames() const
@@ -416,8 +537,75 @@ void VariantListModel::setStorage(const QVariantList &value)
     m_storage = value;
     endResetModel();
     if (oldCount != m_storage.size()) {
+        notifyCountChanged();
+    }
+    schedulePublish();
+}
+
+/*! \fn bool QImmutable::VariantListModel::reset(QVariantList &&storage)
+
+  Replaces the content of this list model by moving in the input storage. It always returns true.
+ */
+
+bool VariantListModel::reset(QVariantList &&storage)
+{
+    if (m_roles.isEmpty() && storage.size() > 0) {
+        setRoleNames(storage.at(0).toMap());
+    }
+
+    int oldCount = m_storage.count();
+    beginResetModel();
+    m_storage = std::move(storage);
+    endResetModel();
+    if (oldCount != m_storage.size()) {
+        notifyCountChanged();
+    }
+    schedulePublish();
+    return true;
+}
+
+void VariantListModel::beginBatch()
+{
+    if (m_batchDepth++ == 0) {
+        m_batchTraceStart = Trace::isEnabled() ? Trace::now() : -1;
+    }
+}
+
+void VariantListModel::endBatch()
+{
+    if (m_batchDepth <= 0 || --m_batchDepth > 0) {
+        return;
+    }
+
+    if (m_countChanged) {
+        m_countChanged = false;
         emit countChanged();
     }
+
+    if (m_batchTraceStart >= 0) {
+        // The signals of the batch are delivered within the span
+        Trace::record("VariantListModel::batch", m_batchTraceStart, Trace::now());
+        m_batchTraceStart = -1;
+    }
+}
+
+void VariantListModel::notifyCountChanged()
+{
+    if (m_batchDepth > 0) {
+        m_countChanged = true;
+    } else {
+        emit countChanged();
+    }
+}
+
+/*! \fn void QImmutable::VariantListModel::setStorage(QVariantList&& value)
+
+  Replace the content of this list model by moving in the input value.
+ */
+
+void VariantListModel::setStorage(QVariantList &&value)
+{
+    reset(std::move(value));
 }
 
 /*! \fn QVariantList QSListModel::storage() const
@@ -448,3 +636,173 @@ int VariantListModel::indexOf(QString field, QVariant value) const
     return res;
 }
 
+
+/*! \fn bool QImmutable::VariantListModel::snapshotEnabled() const
+
+    Returns true if a snapshot of the storage is published after every batch of changes.
+    The default value is false.
+ */
+
+bool VariantListModel::snapshotEnabled() const
+{
+    return m_snapshotEnabled;
+}
+
+void VariantListModel::setSnapshotEnabled(bool value)
+{
+    if (m_snapshotEnabled == value) {
+        return;
+    }
+
+    m_snapshotEnabled = value;
+
+    if (m_snapshotEnabled) {
+        publishSnapshot();
+    } else {
+        QMutexLocker locker(&m_snapshotMutex);
+        m_snapshot = Snapshot();
+    }
+}
+
+/*! \fn Snapshot QImmutable::VariantListModel::snapshot() const
+
+Returns the latest published snapshot. Unlike storage(), it could be called from any thread.
+
+The changes applied to the model are published on the next event loop turn, such that all the patches
+applied by a QSDiffRunner::patch() call are published as a single version. Call publishSnapshot()
+to publish immediately.
+
+Publishing does not copy the storage. Instead, the first change after a publish detaches
+the storage of the model, which is a shallow copy of the items.
+
+If snapshotEnabled is false, a null snapshot is returned.
+
+\sa Snapshot
+ */
+
+Snapshot VariantListModel::snapshot() const
+{
+    QMutexLocker locker(&m_snapshotMutex);
+    return m_snapshot;
+}
+
+/*! \property QImmutable::VariantListModel::diffStatisticsEnabled
+
+    If it is true, a subclass that compares its source (e.g ListModel and ImmutableListModel) collects
+    the cost of every sync into diffStatistics and emits diffStatisticsChanged().
+    The default value is false.
+ */
+
+bool VariantListModel::diffStatisticsEnabled() const
+{
+    return m_diffStatisticsEnabled;
+}
+
+void VariantListModel::setDiffStatisticsEnabled(bool value)
+{
+    if (m_diffStatisticsEnabled == value) {
+        return;
+    }
+    m_diffStatisticsEnabled = value;
+    emit diffStatisticsEnabledChanged();
+}
+
+/*! \property QImmutable::VariantListModel::diffStatistics
+
+    The statistics of the last sync, e.g the time of each phase (in ms), the no. of patches by type,
+    and the fast paths taken. It could be aggregated by a telemetry service on diffStatisticsChanged().
+
+    \sa QImmutable::DiffStatistics
+ */
+
+QVariantMap VariantListModel::diffStatistics() const
+{
+    return m_diffStatistics.toMap();
+}
+
+DiffStatistics VariantListModel::lastDiffStatistics() const
+{
+    return m_diffStatistics;
+}
+
+void VariantListModel::setDiffStatistics(const DiffStatistics &value)
+{
+    m_diffStatistics = value;
+    emit diffStatisticsChanged();
+}
+
+/*! \property QImmutable::VariantListModel::captureFile
+
+    If it is set, a subclass that takes a source (ListModel, ImmutableListModel and JsonListModel)
+    records every source to the file with a timestamp. The file could be replayed against
+    any engine configuration by the replay tool in tests/replay.
+
+    Setting an empty string stops the capture. An existing file is overwritten.
+
+    \sa QImmutable::CaptureWriter
+ */
+
+QString VariantListModel::captureFile() const
+{
+    return m_capture.isNull() ? QString() : m_capture->fileName();
+}
+
+void VariantListModel::setCaptureFile(const QString &fileName)
+{
+    if (captureFile() == fileName) {
+        return;
+    }
+
+    m_capture.clear();
+
+    if (!fileName.isEmpty()) {
+        QSharedPointer<CaptureWriter> writer(new CaptureWriter());
+        if (writer->open(fileName)) {
+            m_capture = writer;
+        }
+    }
+
+    emit captureFileChanged();
+}
+
+void VariantListModel::capture(const QVariantList &source)
+{
+    if (!m_capture.isNull()) {
+        m_capture->write(source);
+    }
+}
+
+/*! \fn void QImmutable::VariantListModel::publishSnapshot()
+
+Publishes the current storage as a new snapshot and emits snapshotPublished().
+It must be called on the model's thread.
+ */
+
+void VariantListModel::publishSnapshot()
+{
+    m_snapshotPending = false;
+
+    if (!m_snapshotEnabled) {
+        return;
+    }
+
+    Snapshot snapshot(++m_version, m_storage);
+
+    {
+        QMutexLocker locker(&m_snapshotMutex);
+        // The previous snapshot is released outside the lock
+        qSwap(m_snapshot, snapshot);
+    }
+
+    emit snapshotPublished();
+}
+
+void VariantListModel::schedulePublish()
+{
+    if (!m_snapshotEnabled || m_snapshotPending) {
+        return;
+    }
+
+    m_snapshotPending = true;
+    QMetaObject::invokeMethod(this, "publishSnapshot", Qt::QueuedConnection);
+}
@@ -10,14 +10,22 @@
 #include <QAbstractListModel>
 #include <QPointer>
 #include <QSharedPointer>
+#include <QMutex>
+#include "qspatch.h"
 #include "qimmutablepatchable.h"
 #include "qimmutablefunctions.h"
+#include "qimmutablesnapshot.h"
+#include "qimmutablediffstatistics.h"
+#include "qimmutablecapture.h"
 
 namespace QImmutable {
-class VariantListModel : public QAbstractListModel, public Patchable
+class VariantListModel : public QAbstractListModel, public BatchPatchable
 {
     Q_OBJECT
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool diffStatisticsEnabled READ diffStatisticsEnabled WRITE setDiffStatisticsEnabled NOTIFY diffStatisticsEnabledChanged)
+    Q_PROPERTY(QVariantMap diffStatistics READ diffStatistics NOTIFY diffStatisticsChanged)
+    Q_PROPERTY(QString captureFile READ captureFile WRITE setCaptureFile NOTIFY captureFileChanged)
 
 public:
     explicit VariantListModel(QObject *parent = 0);
@@ -36,17 +44,49 @@ public:
 
     void setStorage(const QVariantList& value);
 
+    void setStorage(QVariantList&& value);
+
     QVariantList storage() const;
 
+    bool snapshotEnabled() const;
+
+    void setSnapshotEnabled(bool value);
+
+    // Thread-safe
+    Snapshot snapshot() const;
+
+    bool diffStatisticsEnabled() const;
+
+    void setDiffStatisticsEnabled(bool value);
+
+    // The statistics of the last sync. See DiffStatistics::toMap()
+    QVariantMap diffStatistics() const;
+
+    DiffStatistics lastDiffStatistics() const;
+
+    QString captureFile() const;
+
+    // Record every source set on the model to the file. An empty string stops the capture.
+    void setCaptureFile(const QString& fileName);
+
 public slots:
 
+    void publishSnapshot();
+
     int indexOf(QString field,QVariant value) const;
 
     QVariantMap get(int i) const;
 
 protected:
+    // countChanged() is emitted once at the end of a batch
+    virtual void beginBatch();
+
+    virtual void endBatch();
+
     virtual void insert(int index, const QVariantList &value);
 
+    virtual void insert(int index, QVariantList &&value);
+
     virtual void insert(int index, const QVariantMap& value);
 
     virtual void move(int from, int to, int count = 1);
@@ -55,23 +95,77 @@ protected:
 
     virtual void set(int index,QVariantMap data);
 
+    // A single dataChanged() signal is emitted for the range
+    virtual void setRange(int first, int last, QVector<QVariantMap> changes);
+
+    virtual bool reset(QVariantList &&storage);
+
     void setProperty(int index,QString property ,QVariant value);
 
     void append(const QVariantMap&value);
 
     void clear();
 
+    // Called by a subclass after a sync if diffStatisticsEnabled is true
+    void setDiffStatistics(const DiffStatistics& value);
+
+    inline bool capturing() const {
+        return !m_capture.isNull();
+    }
+
+    // Called by a subclass for every source set if capturing() is true
+    void capture(const QVariantList& source);
+
 signals:
     void countChanged();
 
+    void snapshotPublished();
+
+    // Emitted when set() applies a nested QSPatchSet to a list field of an item. It is emitted before
+    // dataChanged(), so a child model like JsonListModel (see its parentModel) applies the sub-patches first.
+    void nestedPatchApplied(int index, const QString& field, const QSPatchSet& patches);
+
+    void diffStatisticsEnabledChanged();
+
+    // Emitted after every sync if diffStatisticsEnabled is true
+    void diffStatisticsChanged();
+
+    void captureFileChanged();
+
 public slots:
 
 private:
+    // Publish a snapshot on the next event loop turn, so a batch of patches is published once
+    void schedulePublish();
+
+    void notifyCountChanged();
+
+    // Merge the changes into the item at idx. The changed roles and the nested fields are appended.
+    void merge(int idx, const QVariantMap& changes, QVector<int>& roles, QStringList& nested);
 
     QHash<int, QByteArray> m_roles;
     QHash<QString, int> m_rolesLookup;
 
     QVariantList m_storage;
+
+    int m_batchDepth;
+    bool m_countChanged;
+
+    // The trace time of the outermost beginBatch(). -1 if tracing is disabled.
+    qint64 m_batchTraceStart;
+
+    bool m_snapshotEnabled;
+    bool m_snapshotPending;
+    quint64 m_version;
+
+    // Guards m_snapshot only. It is held for copying the reference.
+    mutable QMutex m_snapshotMutex;
+    Snapshot m_snapshot;
+
+    bool m_diffStatisticsEnabled;
+    DiffStatistics m_diffStatistics;
+
+    QSharedPointer<CaptureWriter> m_capture;
 };
 
 }
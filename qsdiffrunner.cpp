@@ -8,6 +8,7 @@
 #include <QLinkedList>
 #include "qsdiffrunner.h"
 #include "priv/qsdiffrunneralgo_p.h"
+#include "qimmutabletrace.h"
 
 /*!
   \class QSDiffRunner
@@ -22,7 +23,7 @@ QSDiffRunner use an average O(n) algorithm and therefore it should be fast enoug
 
 QSDiffRunner::QSDiffRunner()
 {
-
+    m_statistics = 0;
 }
 
 QString QSDiffRunner::keyField() const
@@ -57,43 +58,81 @@ void QSDiffRunner::setKeyField(const QString &keyField)
 
 QSPatchSet QSDiffRunner::compare(const QVariantList &from, const QVariantList &to)
 {
+    QImmutable::TraceSpan span("QSDiffRunner::compare", to.size());
     QSDiffRunnerAlgo algo;
     algo.setKeyField(m_keyField);
+    algo.setNestedKeyFields(m_nestedKeyFields);
+    algo.setStatistics(m_statistics);
     return algo.compare(from, to);
 }
 
+/*! \fn void QSDiffRunner::setStatistics(QImmutable::DiffStatistics *statistics)
+
+  Collect the cost of compare() into statistics, e.g the time of each phase and the no. of
+  hash table operations. It is replaced on every compare(). Pass a null pointer to disable it.
+
+  \sa QImmutable::DiffStatistics
+ */
+
+void QSDiffRunner::setStatistics(QImmutable::DiffStatistics *statistics)
+{
+    m_statistics = statistics;
+}
+
+QHash<QString, QString> QSDiffRunner::nestedKeyFields() const
+{
+    return m_nestedKeyFields;
+}
+
+/*! \fn void QSDiffRunner::setNestedKeyField(const QString &field, const QString &keyField)
+
+  Enable nested diff on a list field. If the field of an item is changed, the Update patch
+  carries a QSPatchSet (in a QVariant) that transforms the old list to the new one, instead of the whole new list.
+  The items of the nested list are identified by keyField.
+
+  QSListModel applies the sub-patches to the stored list and emits nestedPatchApplied(),
+  so a nested model could apply only those patches. Other QSPatchable implementations
+  must be able to handle a QSPatchSet value.
+
+  Pass an empty keyField to disable it.
+
+ */
+
+void QSDiffRunner::setNestedKeyField(const QString &field, const QString &keyField)
+{
+    if (keyField.isEmpty()) {
+        m_nestedKeyFields.remove(field);
+    } else {
+        m_nestedKeyFields[field] = keyField;
+    }
+}
+
 /*! \fn bool QSDiffRunner::patch(QSPatchable *patchable, const QSPatchSet& patches) const
 
   Call this function to patch a list model that implemented the QSPatchable interface. You should
   use the result generated by QSDiffRunner::compare().
 
+  If patchable is a BatchPatchable, the patches are applied as a single batch.
+
  */
 
 
 bool QSDiffRunner::patch(QImmutable::Patchable *patchable, const QSPatchSet& patches) const
 {
-    QVariantMap diff;
-    foreach (QSPatch patch, patches) {
-        switch (patch.type()) {
-        case QSPatch::Remove:
-            patchable->remove(patch.from(), patch.count());
-            break;
-        case QSPatch::Insert:
-            patchable->insert(patch.from(), patch.data());
-            break;
-        case QSPatch::Move:
-            patchable->move(patch.from(), patch.to(), patch.count());
-            break;
-        case QSPatch::Update:
-            if (patch.data().size() > 0) {
-                diff = patch.data().at(0).toMap();
-            }
-            patchable->set(patch.from(), diff);
-            break;
-        default:
-            break;
-        }
-    }
+    QImmutable::applyPatches(patchable, patches);
+    return true;
+}
+
+/*! \fn bool QSDiffRunner::patch(QSPatchable *patchable, QSPatchSet&& patches) const
+
+  Same as patch(), but the payloads of insertions are moved to a BatchPatchable instead of being copied.
+  Pass the result of compare() directly to take this overload.
+
+ */
+
+bool QSDiffRunner::patch(QImmutable::Patchable *patchable, QSPatchSet&& patches) const
+{
+    QImmutable::applyPatches(patchable, std::move(patches));
     return true;
 }
 
@@ -10,6 +10,7 @@
 #include "qspatch.h"
 #include "qimmutablepatchable.h"
 #include "qimmutablefunctions.h"
+#include "qimmutablediffstatistics.h"
 
 class QSDiffRunner
 {
@@ -20,11 +21,22 @@ public:
 
     void setKeyField(const QString &value);
 
+    QHash<QString, QString> nestedKeyFields() const;
+
+    // Produce a sub-QSPatchSet for a changed list field, compared by keyField
+    void setNestedKeyField(const QString& field, const QString& keyField);
+
     QSPatchSet compare(const QVariantList& from,
                        const QVariantList& to);
 
+    // If it is set, it is filled with the cost of each compare()
+    void setStatistics(QImmutable::DiffStatistics* statistics);
+
     bool patch(QImmutable::Patchable* patchable, const QSPatchSet& patches) const;
 
+    // The payloads of the patches are moved to a BatchPatchable
+    bool patch(QImmutable::Patchable* patchable, QSPatchSet&& patches) const;
+
 signals:
 
 public slots:
@@ -33,6 +45,10 @@ private:
 
 
     QString m_keyField;
+
+    QHash<QString, QString> m_nestedKeyFields;
+
+    QImmutable::DiffStatistics* m_statistics;
 };
 
 #endif // QSDIFFRUNNER_H
@@ -1,4 +1,7 @@
 #include "priv/qsdiffrunneralgo_p.h"
+#include "qimmutablefunctions.h"
+#include "qimmutabletrace.h"
+#include <climits>
 
 #define MISSING_KEY_WARNING "QSDiffRunner.compare() - Duplicated or missing key."
 
@@ -14,6 +17,8 @@ QSDiffRunnerAlgo::QSDiffRunnerAlgo()
     indexF = -1;
 
     removing = 0;
+
+    m_statistics = 0;
 }
 
 QString QSDiffRunnerAlgo::keyField() const
@@ -26,6 +31,23 @@ void QSDiffRunnerAlgo::setKeyField(const QString &keyField)
     m_keyField = keyField;
 }
 
+void QSDiffRunnerAlgo::setNestedKeyFields(const QHash<QString, QString> &nestedKeyFields)
+{
+    m_nestedKeyFields = nestedKeyFields;
+}
+
+void QSDiffRunnerAlgo::setStatistics(QImmutable::DiffStatistics *statistics)
+{
+    m_statistics = statistics;
+}
+
+void QSDiffRunnerAlgo::countProbes(int count) const
+{
+    if (m_statistics != 0) {
+        m_statistics->hashProbes += count;
+    }
+}
+
 QSPatchSet QSDiffRunnerAlgo::combine()
 {
     if (updatePatches.size() > 0) {
@@ -35,7 +57,7 @@ QSPatchSet QSDiffRunnerAlgo::combine()
     return patches;
 }
 
-QList<QSPatch> QSDiffRunnerAlgo::compareWithoutKey(const QVariantList &from, const QVariantList &to)
+QList<QSPatch> QSDiffRunnerAlgo::compareWithoutKey(const QVariantList &from, const QVariantList &to) const
 {
     QList<QSPatch> patches;
 
@@ -57,30 +79,25 @@ QList<QSPatch> QSDiffRunnerAlgo::compareWithoutKey(const QVariantList &from, con
     return patches;
 }
 
-QVariantMap QSDiffRunnerAlgo::compareMap(const QVariantMap &prev, const QVariantMap &current)
+QVariantMap QSDiffRunnerAlgo::compareMap(const QVariantMap &prev, const QVariantMap &current) const
 {
     // To make this function faster, it won't track removed fields from prev.
     // Clear a field to null value should set it explicitly.
 
-    QVariantMap diff;
-
-    QMap<QString, QVariant>::const_iterator iter = current.begin();
-
-    while (iter != current.end()) {
-        QString key = iter.key();
-        if (!prev.contains(key) ||
-             prev[key] != iter.value()) {
-            diff[key] = iter.value();
-        }
-        iter++;
+    if (m_statistics == 0) {
+        return QImmutable::diff(prev, current, m_nestedKeyFields);
     }
 
-    return diff;
-
+    QElapsedTimer timer;
+    timer.start();
+    QVariantMap res = QImmutable::diff(prev, current, m_nestedKeyFields);
+    m_statistics->fieldDiffTime += timer.nsecsElapsed();
+    return res;
 }
 
 int QSDiffRunnerAlgo::preprocess(const QVariantList &from, const QVariantList &to)
 {
+    QImmutable::TraceSpan span("QSDiffRunnerAlgo::preprocess");
     int index = 0;
     int min = qMin(from.size(), to.size());
     QVariantMap f;
@@ -91,6 +108,10 @@ int QSDiffRunnerAlgo::preprocess(const QVariantList &from, const QVariantList &t
         f = from[index].toMap();
         t = to[index].toMap();
 
+        if (m_statistics != 0) {
+            m_statistics->keyCalls += 2;
+        }
+
         if (f[m_keyField] != t[m_keyField]) {
             break;
         }
@@ -102,6 +123,12 @@ int QSDiffRunnerAlgo::preprocess(const QVariantList &from, const QVariantList &t
         }
     }
 
+    if (m_statistics != 0) {
+        m_statistics->skipped = index;
+        m_statistics->appendToEnd = from.size() == index && to.size() > index;
+        m_statistics->removeFromEnd = to.size() == index && from.size() > index;
+    }
+
     if (from.size() == index && to.size() - index > 0)  {
         // Special case: append to end
         skipped = to.size();
@@ -121,19 +148,92 @@ int QSDiffRunnerAlgo::preprocess(const QVariantList &from, const QVariantList &t
     return index;
 }
 
+// Returns false as soon as a key is not an int or the range can't be dense
+static bool collectIntKeys(const QVariantList& list, const QString& keyField, int skipped, int count,
+                           QVector<int>& keys, int& min, int& max)
+{
+    keys.reserve(list.size() - skipped);
+
+    for (int i = skipped ; i < list.size() ; i++) {
+        int key;
+        if (!toIntKey(list.at(i).toMap().value(keyField), key)) {
+            return false;
+        }
+        min = qMin(min, key);
+        max = qMax(max, key);
+        if (!isDenseRange(min, max, count)) {
+            return false;
+        }
+        keys << key;
+    }
+
+    return true;
+}
+
+bool QSDiffRunnerAlgo::checkKeyRange()
+{
+    int min = INT_MAX;
+    int max = INT_MIN;
+
+    slotsF.clear();
+    slotsT.clear();
+
+    int count = qMax(from.size(), to.size()) - skipped;
+    bool collected = collectIntKeys(from, m_keyField, skipped, count, slotsF, min, max) &&
+                     collectIntKeys(to, m_keyField, skipped, count, slotsT, min, max);
+
+    if (m_statistics != 0) {
+        m_statistics->keyCalls += slotsF.size() + slotsT.size();
+    }
+
+    if (!collected || !isDenseRange(min, max, count)) {
+        slotsF.clear();
+        slotsT.clear();
+        return false;
+    }
+
+    hash.setRange(min, max);
+
+    for (int i = 0 ; i < slotsF.size() ; i++) {
+        slotsF[i] = hash.slot(slotsF[i]);
+    }
+
+    for (int i = 0 ; i < slotsT.size() ; i++) {
+        slotsT[i] = hash.slot(slotsT[i]);
+    }
+
+    return true;
+}
+
+Key QSDiffRunnerAlgo::keyAt(const QVariantList &list, const QVector<int> &slots, int i) const
+{
+    Key key;
+    if (hash.isDense()) {
+        key.slot = slots.at(i - skipped);
+    } else {
+        key.string = list.at(i).toMap()[m_keyField].toString();
+        if (m_statistics != 0) {
+            m_statistics->keyCalls++;
+        }
+    }
+    return key;
+}
+
 void QSDiffRunnerAlgo::buildHashTable()
 {
-    hash.reserve( (qMax(to.size(), from.size()) - skipped) * 2 + 100);
+    QImmutable::TraceSpan span("QSDiffRunnerAlgo::buildHashTable");
+    if (!checkKeyRange()) {
+        hash.reserve( (qMax(to.size(), from.size()) - skipped) * 2 + 100);
+    }
 
     State state;
-    QVariantMap item;
-    QString key;
+    Key key;
     int fromSize = from.size();
     int toSize = to.size();
 
     for (int i = skipped; i < fromSize ; i++) {
-        item = from.at(i).toMap();
-        key = item[m_keyField].toString();
+        key = keyAt(from, slotsF, i);
+        countProbes(2);
         if (hash.contains(key)) {
             qWarning() << MISSING_KEY_WARNING;
             //@TODO fail back to burte force mode
@@ -144,8 +244,8 @@ void QSDiffRunnerAlgo::buildHashTable()
     }
 
     for (int i = skipped; i < toSize ; i++) {
-        item = to.at(i).toMap();
-        key = item[m_keyField].toString();
+        key = keyAt(to, slotsT, i);
+        countProbes(2);
 
         if (hash.contains(key)) {
             hash[key].posT = i;
@@ -191,6 +291,10 @@ void QSDiffRunnerAlgo::appendMovePatch(QSAlgoTypes::MoveOp &moveOp)
     QImmutable::TreeNode* node = tree.insert(moveOp.posF,moveOp.count);
     offset = tree.countLessThan(node);
 
+    if (m_statistics != 0) {
+        m_statistics->treeOperations += 2;
+    }
+
     if (offset > 0) {
         patch.setFrom(patch.from() - offset);
     }
@@ -211,10 +315,33 @@ void QSDiffRunnerAlgo::updateTree()
 {
     while (tree.root() != 0 && tree.min() <= indexF) {
         tree.remove(tree.min());
+        if (m_statistics != 0) {
+            m_statistics->treeOperations++;
+        }
     }
 }
 
-QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantList &to) {
+QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantList &to)
+{
+    if (m_statistics == 0) {
+        return run(from, to);
+    }
+
+    m_statistics->clear();
+    m_statistics->fromCount = from.size();
+    m_statistics->toCount = to.size();
+    m_clock.start();
+
+    QSPatchSet res = run(from, to);
+
+    m_statistics->totalTime = m_clock.nsecsElapsed();
+    m_statistics->walkTime = m_statistics->totalTime - m_statistics->prefixScanTime - m_statistics->hashBuildTime;
+    m_statistics->countPatches(res);
+    return res;
+}
+
+QSPatchSet QSDiffRunnerAlgo::run(const QVariantList &from, const QVariantList &to)
+{
     patches.clear();
     updatePatches.clear();
 
@@ -228,6 +355,10 @@ QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantLis
     // Compare the list, until it found moved component.
     preprocess(from, to);
 
+    if (m_statistics != 0) {
+        m_statistics->prefixScanTime = m_clock.nsecsElapsed();
+    }
+
     if (skipped >= from.size() &&
         skipped >= to.size()) {
         // Nothing moved
@@ -237,6 +368,10 @@ QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantLis
     buildHashTable();
     //@TODO - Discover duplicated key
 
+    if (m_statistics != 0) {
+        m_statistics->hashBuildTime = m_clock.nsecsElapsed() - m_statistics->prefixScanTime;
+    }
+
     indexF = skipped;
     indexT = skipped;
     int fromSize = from.size();
@@ -251,8 +386,9 @@ QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantLis
         while (indexF < fromSize) {
             // Process until it found an item that remain in origianl position (neither removd / moved).
             itemF = from.at(indexF).toMap();
-            keyF = itemF[m_keyField].toString();
+            keyF = keyAt(from, slotsF, indexF);
             state = hash[keyF]; // It mush obtain the key value
+            countProbes(1);
 
 
             if (state.posT < 0) {
@@ -276,8 +412,9 @@ QSPatchSet QSDiffRunnerAlgo::compare(const QVariantList &from, const QVariantLis
 
         while (indexT < toSize ) {
             itemT = to.at(indexT).toMap();
-            keyT = itemT[m_keyField].toString();
+            keyT = keyAt(to, slotsT, indexT);
             state = hash[keyT];
+            countProbes(1);
 
             if (state.posF < 0) {
                 // new item
@@ -328,6 +465,7 @@ void QSDiffRunnerAlgo::markItemAtFromList(QSAlgoTypes::Type type, State &state)
 
     state.posF = indexF;
     hash[keyF] = state;
+    countProbes(1);
 }
 
 void QSDiffRunnerAlgo::markItemAtToList(QSAlgoTypes::Type type, State& state)
@@ -362,6 +500,7 @@ void QSDiffRunnerAlgo::markItemAtToList(QSAlgoTypes::Type type, State& state)
 
         state.isMoved = true;
         hash[keyT] = state;
+        countProbes(1);
     }
 
     if (type != QSAlgoTypes::Move && !pendingMovePatch.isNull()) {
@@ -66,6 +66,7 @@ It will emit signals of insertion, removal and moving automatically.
 QSJsonListModel::QSJsonListModel(QObject *parent) : VariantListModel(parent)
 {
     componentCompleted = false;
+    m_parentIndex = -1;
 }
 
 /*! \qmlproperty string JsonListModel::keyField
@@ -122,6 +123,10 @@ QVariantList QSJsonListModel::source() const
 
 void QSJsonListModel::setSource(const QVariantList &source)
 {
+    if (capturing()) {
+        capture(source);
+    }
+
     m_source = source;
 
     if (componentCompleted) {
@@ -165,6 +170,165 @@ void QSJsonListModel::setFields(const QStringList &roleNames)
     emit fieldsChanged();
 }
 
+/*! \qmlproperty object JsonListModel::parentModel
+
+  A model derived from VariantListModel (e.g. a QSListModel synced by QSDiffRunner) that holds
+  the list of this model in the parentField of the item at parentIndex. If they are set, the list is
+  taken as source and the source property should not be bound.
+
+  If the parent is patched with a nested key field (QSDiffRunner::setNestedKeyField()), the
+  sub-patches of the list are applied to this model directly. Therefore, moving one item in the list
+  is a single move, without comparing the whole list again.
+
+  Example:
+
+\code
+    ListView {
+        model: BoardModel
+
+        delegate: ListView {
+            model: JsonListModel {
+                keyField: "uuid"
+                parentModel: BoardModel
+                parentIndex: index
+                parentField: "cards"
+            }
+        }
+    }
+\endcode
+
+ */
+
+QObject *QSJsonListModel::parentModel() const
+{
+    return m_parentModel.data();
+}
+
+void QSJsonListModel::setParentModel(QObject *parentModel)
+{
+    QImmutable::VariantListModel* model = qobject_cast<QImmutable::VariantListModel*>(parentModel);
+
+    if (parentModel != 0 && model == 0) {
+        qWarning() << "JsonListModel: parentModel is not a VariantListModel";
+    }
+
+    if (m_parentModel == model) {
+        return;
+    }
+
+    if (!m_parentModel.isNull()) {
+        m_parentModel->disconnect(this);
+    }
+
+    m_parentModel = model;
+
+    if (model != 0) {
+        connect(model, &QImmutable::VariantListModel::nestedPatchApplied,
+                this, &QSJsonListModel::onParentNestedPatchApplied);
+        connect(model, &QAbstractItemModel::dataChanged,
+                this, &QSJsonListModel::onParentDataChanged);
+        connect(model, &QAbstractItemModel::modelReset,
+                this, &QSJsonListModel::followParent);
+    }
+
+    followParent();
+    emit parentModelChanged();
+}
+
+/*! \qmlproperty int JsonListModel::parentIndex
+
+  The index of the item in parentModel. Bind it to the index of a delegate, so it follows the moves of the item.
+ */
+
+int QSJsonListModel::parentIndex() const
+{
+    return m_parentIndex;
+}
+
+void QSJsonListModel::setParentIndex(int parentIndex)
+{
+    if (m_parentIndex == parentIndex) {
+        return;
+    }
+
+    m_parentIndex = parentIndex;
+    followParent();
+    emit parentIndexChanged();
+}
+
+/*! \qmlproperty string JsonListModel::parentField
+
+  The list field of the item in parentModel
+ */
+
+QString QSJsonListModel::parentField() const
+{
+    return m_parentField;
+}
+
+void QSJsonListModel::setParentField(const QString &parentField)
+{
+    if (m_parentField == parentField) {
+        return;
+    }
+
+    m_parentField = parentField;
+    followParent();
+    emit parentFieldChanged();
+}
+
+void QSJsonListModel::onParentNestedPatchApplied(int index, const QString &field, const QSPatchSet &patches)
+{
+    if (index != m_parentIndex || field != m_parentField) {
+        return;
+    }
+
+    if (!componentCompleted) {
+        followParent();
+        return;
+    }
+
+    // The parent is emitting it before dataChanged(), so the list is shared by then
+    m_source = parentValue().toList();
+
+    QSDiffRunner runner;
+    runner.patch(this, patches);
+
+    emit sourceChanged();
+}
+
+void QSJsonListModel::onParentDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (m_parentIndex >= topLeft.row() && m_parentIndex <= bottomRight.row()) {
+        followParent();
+    }
+}
+
+QVariant QSJsonListModel::parentValue() const
+{
+    if (m_parentModel.isNull() || m_parentField.isEmpty() ||
+        m_parentIndex < 0 || m_parentIndex >= m_parentModel->count()) {
+        return QVariant();
+    }
+
+    return m_parentModel->storage().at(m_parentIndex).toMap().value(m_parentField);
+}
+
+void QSJsonListModel::followParent()
+{
+    QVariant value = parentValue();
+    if (!value.isValid()) {
+        return;
+    }
+
+    QVariantList list = value.toList();
+    if (list.isSharedWith(m_source)) {
+        return;
+    }
+
+    setSource(list);
+}
+
 void QSJsonListModel::classBegin()
 {
 
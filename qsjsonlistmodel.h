@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
 #include <QQmlParserStatus>
 #include "qimmutablevariantlistmodel.h"
 
@@ -16,6 +17,9 @@ class QSJsonListModel : public QImmutable::VariantListModel, public QQmlParserSt
     Q_PROPERTY(QString keyField READ keyField WRITE setKeyField NOTIFY keyFieldChanged)
     Q_PROPERTY(QVariantList source READ source WRITE setSource NOTIFY sourceChanged)
     Q_PROPERTY(QStringList fields READ fields WRITE setFields NOTIFY fieldsChanged)
+    Q_PROPERTY(QObject* parentModel READ parentModel WRITE setParentModel NOTIFY parentModelChanged)
+    Q_PROPERTY(int parentIndex READ parentIndex WRITE setParentIndex NOTIFY parentIndexChanged)
+    Q_PROPERTY(QString parentField READ parentField WRITE setParentField NOTIFY parentFieldChanged)
     Q_INTERFACES(QQmlParserStatus)
 
 public:
@@ -33,6 +37,18 @@ public:
 
     void setFields(const QStringList &roleNames);
 
+    QObject* parentModel() const;
+
+    void setParentModel(QObject* parentModel);
+
+    int parentIndex() const;
+
+    void setParentIndex(int parentIndex);
+
+    QString parentField() const;
+
+    void setParentField(const QString& parentField);
+
 signals:
 
     void keyFieldChanged();
@@ -41,15 +57,32 @@ signals:
 
     void fieldsChanged();
 
+    void parentModelChanged();
+
+    void parentIndexChanged();
+
+    void parentFieldChanged();
+
 public slots:
 
 protected:
     virtual void classBegin();
     virtual void componentComplete();
 
+private slots:
+    void onParentNestedPatchApplied(int index, const QString& field, const QSPatchSet& patches);
+
+    void onParentDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+
 private:
     void sync();
 
+    // The list field of the parent item, or an invalid QVariant if it is not available
+    QVariant parentValue() const;
+
+    // Take the list field of the parent item as source unless it is the same list
+    void followParent();
+
     QString m_keyField;
 
     QVariantList m_source;
@@ -57,4 +90,10 @@ private:
     QStringList m_fields;
 
     bool componentCompleted;
+
+    QPointer<QImmutable::VariantListModel> m_parentModel;
+
+    int m_parentIndex;
+
+    QString m_parentField;
 };
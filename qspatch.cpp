@@ -31,7 +31,7 @@ public:
     }
 
     QSPatch::Type type;
-    QVariant data;
+    QVariantList data;
     int from;
     int to;
     int count;
@@ -57,10 +57,7 @@ QSPatch::QSPatch(QSPatch::Type type, int from, int to, int count, const QVariant
     d->to = to;
     d->count = count;
 
-    QVariantList list;
-    list.append(data);
-
-    d->data = list;
+    d->data.append(data);
 }
 
 QSPatch::QSPatch(Type type,int from, int to, int count, const QVariantList& data) : d(new QSPatchPriv) {
@@ -71,12 +68,30 @@ QSPatch::QSPatch(Type type,int from, int to, int count, const QVariantList& data
     d->data = data;
 }
 
+/*! \fn QSPatch::QSPatch(Type type,int from, int to, int count, QVariantList&& data)
+
+  Constructs a patch that takes the ownership of data. It avoids touching the reference count of the items.
+ */
+
+QSPatch::QSPatch(Type type,int from, int to, int count, QVariantList&& data) : d(new QSPatchPriv) {
+    d->type = type;
+    d->from = from;
+    d->to = to;
+    d->count = count;
+    d->data = std::move(data);
+}
+
 
 QSPatch::QSPatch(const QSPatch &rhs) : d(rhs.d)
 {
 
 }
 
+// Same as other implicitly shared classes, a moved-from patch could only be assigned or destroyed
+QSPatch::QSPatch(QSPatch &&rhs) Q_DECL_NOTHROW : d(std::move(rhs.d))
+{
+}
+
 QSPatch &QSPatch::operator=(const QSPatch &rhs)
 {
     if (this != &rhs)
@@ -84,6 +99,12 @@ QSPatch &QSPatch::operator=(const QSPatch &rhs)
     return *this;
 }
 
+QSPatch &QSPatch::operator=(QSPatch &&rhs) Q_DECL_NOTHROW
+{
+    d.swap(rhs.d);
+    return *this;
+}
+
 QSPatch::~QSPatch()
 {
 
@@ -99,9 +120,22 @@ void QSPatch::setType(const QSPatch::Type &type)
     d->type = type;
 }
 
-QVariantList QSPatch::data() const
+const QVariantList& QSPatch::data() const
 {
-    return d->data.toList();
+    return d->data;
+}
+
+/*! \fn QVariantList QSPatch::takeData()
+
+  Moves the data out of this patch, and leaves it empty. If the data is not shared with another
+  copy of the patch, the items are handed over without a copy.
+ */
+
+QVariantList QSPatch::takeData()
+{
+    QVariantList res;
+    res.swap(d->data);
+    return res;
 }
 
 void QSPatch::setData(const QVariantList &data)
@@ -109,17 +143,22 @@ void QSPatch::setData(const QVariantList &data)
     d->data = data;
 }
 
+void QSPatch::setData(QVariantList &&data)
+{
+    d->data = std::move(data);
+}
+
 void QSPatch::setData(const QVariantMap &data)
 {
     QVariantList list;
     list << data;
-    d->data = list;
+    d->data = std::move(list);
 }
 
 bool QSPatch::operator==(const QSPatch &rhs) const
 {
     if (d->type != rhs.d->type ||
-        d->data.toList() != rhs.data() ||
+        d->data != rhs.data() ||
         d->from != rhs.from() ||
         d->to != rhs.to() ||
         d->count != rhs.count()) {
@@ -217,11 +256,9 @@ QSPatch &QSPatch::merge(const QSPatch &other)
     } else if (d->type == QSPatch::Move) {
         d->count = d->count + other.count();
     } else if (d->type == QSPatch::Insert) {
-        QVariantList list = d->data.toList();
-        list.append(other.data());
-        d->data = list;
-        d->to  = d->from + list.count() - 1;
-        d->count = list.count();
+        d->data.append(other.data());
+        d->to  = d->from + d->data.count() - 1;
+        d->count = d->data.count();
     }
 
     return *this;
@@ -258,6 +295,10 @@ QDebug operator<<(QDebug dbg, const QSPatch& patch){
         dbg << patch.data();
         break;
 
+    case QSPatch::Reset:
+        dbg << QString("Reset %1 items with %2 items").arg(patch.count()).arg(patch.data().size());
+        break;
+
     default:
         dbg << "Null";
         break;
@@ -267,3 +308,41 @@ QDebug operator<<(QDebug dbg, const QSPatch& patch){
 }
 
 
+
+static void registerTypes()
+{
+    qRegisterMetaType<QSPatch>();
+    qRegisterMetaType<QSPatchSet>();
+
+    // A nested QSPatchSet may be saved within a QVariant
+    qRegisterMetaTypeStreamOperators<QSPatch>();
+    qRegisterMetaTypeStreamOperators<QSPatchSet>();
+}
+
+Q_COREAPP_STARTUP_FUNCTION(registerTypes)
+
+QDataStream& operator<<(QDataStream& stream, const QSPatch& patch)
+{
+    stream << (qint32) patch.type()
+           << (qint32) patch.from()
+           << (qint32) patch.to()
+           << (qint32) patch.count()
+           << patch.data();
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, QSPatch& patch)
+{
+    qint32 type, from, to, count;
+    QVariantList data;
+
+    stream >> type >> from >> to >> count >> data;
+
+    if (stream.status() != QDataStream::Ok) {
+        patch = QSPatch();
+        return stream;
+    }
+
+    patch = QSPatch((QSPatch::Type) type, from, to, count, data);
+    return stream;
+}
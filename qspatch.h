@@ -19,24 +19,33 @@ public:
         Insert,
         Remove,
         Update,
-        Move
+        Move,
+        // Replace the whole list. count is the no. of items removed, and data is the new list.
+        Reset
     };
 
     QSPatch();
     QSPatch(Type type,int from = 0, int to = 0, int count = 0);
     QSPatch(Type type,int from, int to, int count, const QVariantMap& data);
     QSPatch(Type type,int from, int to, int count, const QVariantList& data);
+    QSPatch(Type type,int from, int to, int count, QVariantList&& data);
 
     QSPatch(const QSPatch &);
+    QSPatch(QSPatch &&) Q_DECL_NOTHROW;
     QSPatch &operator=(const QSPatch &);
+    QSPatch &operator=(QSPatch &&) Q_DECL_NOTHROW;
     ~QSPatch();
 
     QSPatch::Type type() const;
     void setType(const QSPatch::Type &type);
 
-    QVariantList data() const;
+    const QVariantList& data() const;
+
+    // Move the data out of this patch. The data of this patch becomes empty.
+    QVariantList takeData();
 
     void setData(const QVariantList &data);
+    void setData(QVariantList &&data);
     void setData(const QVariantMap& data);
 
     bool operator==(const QSPatch& rhs) const;
@@ -71,6 +80,10 @@ private:
 
 QDebug operator<<(QDebug dbg, const QSPatch& change);
 
+QDataStream& operator<<(QDataStream& stream, const QSPatch& patch);
+
+QDataStream& operator>>(QDataStream& stream, QSPatch& patch);
+
 typedef QList<QSPatch> QSPatchSet;
 
 Q_DECLARE_METATYPE(QSPatch)
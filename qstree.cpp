@@ -21,6 +21,15 @@ bool Tree::isNull() const
     return m_root == 0;
 }
 
+void Tree::clear()
+{
+    if (m_root) {
+        delete m_root;
+    }
+    m_root = 0;
+    m_min = m_max = m_sum = m_height = 0;
+}
+
 int Tree::min() const
 {
     return m_min;
@@ -0,0 +1,171 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QFile>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "allocations.h"
+
+static std::atomic<quint64> allocationCount(0);
+static std::atomic<quint64> allocationBytes(0);
+
+static inline void countAllocation(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+
+// Qt containers (QArrayData, QListData, QHash and QMap nodes) allocate by malloc() and
+// realloc() instead of operator new, so they are counted at the malloc level. The
+// definitions in the executable take over the ones of glibc for every library, and
+// forward to the glibc implementation. The default operator new calls malloc(), so
+// it is counted too.
+
+extern "C" {
+
+void* __libc_malloc(std::size_t size) __THROW;
+void* __libc_calloc(std::size_t count, std::size_t size) __THROW;
+void* __libc_realloc(void* ptr, std::size_t size) __THROW;
+void __libc_free(void* ptr) __THROW;
+
+void* malloc(std::size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) __THROW
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+// A realloc() is counted as an allocation of the new size, as it may move the block
+void* realloc(void* ptr, std::size_t size) __THROW
+{
+    if (size > 0) {
+        countAllocation(size);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) __THROW
+{
+    __libc_free(ptr);
+}
+
+}
+
+bool Allocations::countsMalloc()
+{
+    return true;
+}
+
+#else
+
+// Only the global operator new could be replaced portably. The allocations made by
+// malloc() and realloc() in Qt containers are not counted.
+void* operator new(std::size_t size)
+{
+    countAllocation(size);
+
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) Q_DECL_NOTHROW
+{
+    std::free(ptr);
+}
+
+bool Allocations::countsMalloc()
+{
+    return false;
+}
+
+#endif
+
+quint64 Allocations::count()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+quint64 Allocations::bytes()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+// A field of /proc/self/status in KB
+static qint64 readStatus(const QByteArray& field)
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    QList<QByteArray> lines = file.readAll().split('\n');
+    for (int i = 0 ; i < lines.size() ; i++) {
+        if (lines.at(i).startsWith(field + ":")) {
+            // e.g "VmHWM:     1234 kB"
+            return lines.at(i).mid(field.size() + 1).trimmed().split(' ').first().toLongLong();
+        }
+    }
+#else
+    Q_UNUSED(field);
+#endif
+    return 0;
+}
+
+bool Allocations::resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    // Writing 5 to clear_refs resets VmHWM to the current RSS
+    QFile file("/proc/self/clear_refs");
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    return file.write("5") == 1;
+#else
+    // ru_maxrss of getrusage() can't be reset, it would report the largest case for every later one
+    return false;
+#endif
+}
+
+qint64 Allocations::rss()
+{
+    return readStatus("VmRSS");
+}
+
+qint64 Allocations::peakRss()
+{
+    return readStatus("VmHWM");
+}
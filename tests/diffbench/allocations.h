@@ -0,0 +1,34 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QtGlobal>
+
+namespace Allocations {
+
+// The no. of heap allocations since the start of the process
+quint64 count();
+
+// The no. of bytes requested by the heap allocations since the start of the process
+quint64 bytes();
+
+// True if malloc(), calloc() and realloc() are counted (glibc). Otherwise, only the
+// global operator new is counted, and most allocations of Qt containers are missed.
+bool countsMalloc();
+
+// Reset the peak resident set size to the current one, so peakRss() covers what follows.
+// It is supported on Linux only. Returns false if it is not supported.
+bool resetPeakRss();
+
+// The resident set size of the process in KB. It is 0 if it is not supported.
+qint64 rss();
+
+// The peak resident set size of the process since the last resetPeakRss() in KB. It is 0 if
+// it is not supported.
+qint64 peakRss();
+
+}
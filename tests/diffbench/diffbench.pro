@@ -0,0 +1,27 @@
+QT       += qml
+QT       -= gui
+
+TARGET = diffbench
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../qimmutabletests
+
+SOURCES += \
+    main.cpp \
+    workloads.cpp \
+    engines.cpp \
+    allocations.cpp \
+    ../qimmutabletests/immutabletype1.cpp \
+    ../qimmutabletests/immutabletype2.cpp
+
+HEADERS += \
+    workloads.h \
+    engines.h \
+    allocations.h \
+    ../qimmutabletests/immutabletype1.h \
+    ../qimmutabletests/immutabletype2.h
+
+include(../../qimmutable.pri)
@@ -0,0 +1,292 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include <QJSEngine>
+#include "engines.h"
+#include "allocations.h"
+#include "immutabletype2.h"
+#include "qsdiffrunner.h"
+#include "qimmutablefastdiffrunner.h"
+#include "qimmutablevariantlistmodel.h"
+#include "priv/qimmutableqmllistmodel_p.h"
+
+using namespace QImmutable;
+
+// The no. of rows visible in a view
+static const int Viewport = 50;
+
+Result::Result()
+{
+    size = 0;
+    repeat = 0;
+    compareNs = 0;
+    applyNs = 0;
+    signalNs = 0;
+    patches = 0;
+    signalCount = 0;
+    compareAllocations = 0;
+    compareBytes = 0;
+    applyAllocations = 0;
+    applyBytes = 0;
+    peakRss = 0;
+    peakRssDelta = 0;
+}
+
+QJsonObject Result::toJson() const
+{
+    QJsonObject res;
+    res["engine"] = engine;
+    res["workload"] = workload;
+    res["size"] = size;
+    res["repeat"] = repeat;
+    res["compareNs"] = (double) compareNs;
+    res["applyNs"] = (double) applyNs;
+    res["signalNs"] = (double) signalNs;
+    res["patches"] = patches;
+    res["signals"] = signalCount;
+    res["compareAllocations"] = (double) compareAllocations;
+    res["compareAllocatedBytes"] = (double) compareBytes;
+    res["applyAllocations"] = (double) applyAllocations;
+    res["applyAllocatedBytes"] = (double) applyBytes;
+    res["peakRssKb"] = (double) peakRss;
+    res["peakRssDeltaKb"] = (double) peakRssDelta;
+    return res;
+}
+
+SignalProbe::SignalProbe(QAbstractItemModel *model, QObject *parent) : QObject(parent), m_model(model)
+{
+    count = 0;
+    m_roles = model->roleNames().keys();
+
+    connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(onRowsInserted(QModelIndex,int,int)));
+    connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(onRowsRemoved(QModelIndex,int,int)));
+    connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(onRowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), this, SLOT(onDataChanged(QModelIndex,QModelIndex)));
+    connect(model, SIGNAL(modelReset()), this, SLOT(onModelReset()));
+}
+
+void SignalProbe::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    count++;
+    touch(first, last);
+}
+
+void SignalProbe::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    Q_UNUSED(first);
+    Q_UNUSED(last);
+    count++;
+}
+
+void SignalProbe::onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    Q_UNUSED(parent);
+    Q_UNUSED(destination);
+    count++;
+    int first = row > start ? row - (end - start + 1) : row;
+    touch(first, first + end - start);
+}
+
+void SignalProbe::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    count++;
+    touch(topLeft.row(), bottomRight.row());
+}
+
+void SignalProbe::onModelReset()
+{
+    count++;
+    touch(0, m_model->rowCount() - 1);
+}
+
+void SignalProbe::touch(int first, int last)
+{
+    last = qMin(last, first + Viewport - 1);
+    for (int i = first ; i <= last ; i++) {
+        QModelIndex index = m_model->index(i, 0);
+        for (int j = 0 ; j < m_roles.size() ; j++) {
+            m_model->data(index, m_roles.at(j));
+        }
+    }
+}
+
+template <typename T>
+static QVariantList toVariantList(const QList<T>& list)
+{
+    QVariantList res;
+    res.reserve(list.size());
+    for (int i = 0 ; i < list.size() ; i++) {
+        res << QImmutable::convert(list.at(i));
+    }
+    return res;
+}
+
+static QList<ImmutableType2> toKeyless(const QList<ImmutableType1>& list)
+{
+    QList<ImmutableType2> res;
+    res.reserve(list.size());
+    for (int i = 0 ; i < list.size() ; i++) {
+        res << ImmutableType2(list.at(i).id() + ":" + list.at(i).value());
+    }
+    return res;
+}
+
+// Run the comparison, then apply the patches to the model with and without a receiver
+template <typename CompareFunc>
+static Result measure(VariantListModel* model, const QVariantList& initial, CompareFunc compare, int repeat)
+{
+    Result res;
+    res.repeat = repeat;
+
+    bool peakRssReset = Allocations::resetPeakRss();
+    qint64 initialRss = Allocations::rss();
+
+    for (int i = 0 ; i < repeat ; i++) {
+        model->setStorage(initial);
+
+        quint64 allocations = Allocations::count();
+        quint64 bytes = Allocations::bytes();
+        QElapsedTimer timer;
+
+        timer.start();
+        QSPatchSet patches = compare();
+        qint64 compareNs = timer.nsecsElapsed();
+
+        quint64 compareAllocations = Allocations::count() - allocations;
+        quint64 compareBytes = Allocations::bytes() - bytes;
+
+        // The copy of the patches is not counted
+        QSPatchSet payload = patches;
+        allocations = Allocations::count();
+        bytes = Allocations::bytes();
+
+        timer.restart();
+        applyPatches(model, std::move(payload));
+        qint64 applyNs = timer.nsecsElapsed();
+
+        quint64 applyAllocations = Allocations::count() - allocations;
+        quint64 applyBytes = Allocations::bytes() - bytes;
+
+        model->setStorage(initial);
+        SignalProbe probe(model);
+        payload = patches;
+        timer.restart();
+        applyPatches(model, std::move(payload));
+        qint64 signalNs = qMax<qint64>(timer.nsecsElapsed() - applyNs, 0);
+
+        if (i == 0) {
+            res.compareNs = compareNs;
+            res.applyNs = applyNs;
+            res.signalNs = signalNs;
+            res.compareAllocations = compareAllocations;
+            res.compareBytes = compareBytes;
+            res.applyAllocations = applyAllocations;
+            res.applyBytes = applyBytes;
+        } else {
+            res.compareNs = qMin(res.compareNs, compareNs);
+            res.applyNs = qMin(res.applyNs, applyNs);
+            res.signalNs = qMin(res.signalNs, signalNs);
+        }
+
+        res.patches = patches.size();
+        res.signalCount = probe.count;
+    }
+
+    if (peakRssReset) {
+        res.peakRss = Allocations::peakRss();
+        res.peakRssDelta = qMax<qint64>(res.peakRss - initialRss, 0);
+    }
+    return res;
+}
+
+static Result runQSDiffRunner(const Workload& workload, int repeat)
+{
+    QVariantList from = toVariantList(workload.from);
+    QVariantList to = toVariantList(workload.to);
+
+    QSDiffRunner runner;
+    if (workload.keyed) {
+        runner.setKeyField("id");
+    }
+
+    VariantListModel model;
+    return measure(&model, from, [&]() {
+        return runner.compare(from, to);
+    }, repeat);
+}
+
+static Result runFastDiffRunner(const Workload& workload, int repeat)
+{
+    VariantListModel model;
+
+    if (workload.keyed) {
+        FastDiffRunner<ImmutableType1> runner;
+        return measure(&model, toVariantList(workload.from), [&]() {
+            return runner.compare(workload.from, workload.to);
+        }, repeat);
+    }
+
+    QList<ImmutableType2> from = toKeyless(workload.from);
+    QList<ImmutableType2> to = toKeyless(workload.to);
+
+    FastDiffRunner<ImmutableType2> runner;
+    return measure(&model, toVariantList(from), [&]() {
+        return runner.compare(from, to);
+    }, repeat);
+}
+
+// The same comparison as QmlListModel::setSource(), but the phases are measured separately
+static Result runQmlListModel(const Workload& workload, int repeat)
+{
+    QJSEngine engine;
+    QVariantList from = toVariantList(workload.from);
+    QJSValue jsFrom = engine.toScriptValue(from);
+    QJSValue jsTo = engine.toScriptValue(toVariantList(workload.to));
+
+    Item<QJSValue> wrapper;
+    if (workload.keyed) {
+        wrapper.keyField = "id";
+    }
+
+    FastDiffRunnerAlgo<QJSValue> algo;
+    algo.setWrapper(wrapper);
+
+    QmlListModel model;
+    return measure(&model, from, [&]() {
+        QSPatchSet res = algo.compare(jsFrom, jsTo);
+        algo.reset();
+        return res;
+    }, repeat);
+}
+
+QStringList Engines::names()
+{
+    return QStringList() << "qsdiffrunner" << "fastdiffrunner" << "qmllistmodel";
+}
+
+Result Engines::run(const QString &engine, const Workload &workload, int repeat)
+{
+    Result res;
+
+    if (engine == "qsdiffrunner") {
+        res = runQSDiffRunner(workload, repeat);
+    } else if (engine == "fastdiffrunner") {
+        res = runFastDiffRunner(workload, repeat);
+    } else if (engine == "qmllistmodel") {
+        res = runQmlListModel(workload, repeat);
+    } else {
+        qWarning() << "diffbench: Unknown engine" << engine;
+        return res;
+    }
+
+    res.engine = engine;
+    res.workload = workload.name;
+    res.size = workload.from.size();
+    return res;
+}
@@ -0,0 +1,79 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QJsonObject>
+#include <QAbstractItemModel>
+#include "workloads.h"
+
+/// The measurement of a workload on an engine
+class Result {
+public:
+    Result();
+
+    QJsonObject toJson() const;
+
+    QString engine;
+    QString workload;
+    int size;
+    int repeat;
+
+    // The minimum wall time of the repeats
+    qint64 compareNs;
+    qint64 applyNs;
+
+    // The extra time of applying the patches with a view-like receiver connected to the model
+    qint64 signalNs;
+
+    int patches;
+    int signalCount;
+
+    // Counted in compare() of a single run
+    quint64 compareAllocations;
+    quint64 compareBytes;
+
+    // Counted in patch() of a single run
+    quint64 applyAllocations;
+    quint64 applyBytes;
+
+    // The peak RSS during the runs of this case, and its growth over the RSS at the start (KB).
+    // They are 0 if the peak can't be reset per case (Linux only).
+    qint64 peakRss;
+    qint64 peakRssDelta;
+};
+
+/// Receives the signals of a model like a view. It reads the roles of the changed rows within a viewport.
+class SignalProbe : public QObject {
+    Q_OBJECT
+public:
+    explicit SignalProbe(QAbstractItemModel* model, QObject* parent = 0);
+
+    int count;
+
+private slots:
+    void onRowsInserted(const QModelIndex& parent, int first, int last);
+    void onRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+    void onModelReset();
+
+private:
+    void touch(int first, int last);
+
+    QAbstractItemModel* m_model;
+    QList<int> m_roles;
+};
+
+namespace Engines {
+
+// qsdiffrunner, fastdiffrunner, qmllistmodel
+QStringList names();
+
+Result run(const QString& engine, const Workload& workload, int repeat);
+
+}
@@ -0,0 +1,107 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include "workloads.h"
+#include "engines.h"
+#include "allocations.h"
+
+static QtMessageHandler defaultHandler = 0;
+
+// The duplicateKeys workload warns on every duplicated key
+static void messageHandler(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    if (type == QtWarningMsg && message.contains("Duplicated or missing key")) {
+        return;
+    }
+    defaultHandler(type, context, message);
+}
+
+static QStringList parseList(const QCommandLineParser& parser, const QCommandLineOption& option, const QStringList& all)
+{
+    QString value = parser.value(option);
+    if (value.isEmpty()) {
+        return all;
+    }
+    return value.split(",", QString::SkipEmptyParts);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    defaultHandler = qInstallMessageHandler(messageHandler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure the compare, patch and signal cost of the diff engines. "
+                                     "The result is written as JSON.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma separated list sizes.", "sizes", "100,1000,10000,100000,1000000");
+    QCommandLineOption workloadsOption("workloads", "Comma separated workloads: " + Workloads::names().join(","), "workloads");
+    QCommandLineOption enginesOption("engines", "Comma separated engines: " + Engines::names().join(","), "engines");
+    QCommandLineOption repeatOption("repeat", "No. of runs per case. The minimum time is reported.", "repeat", "3");
+    QCommandLineOption outputOption("output", "Write the result to a file instead of stdout.", "file");
+
+    parser.addOption(sizesOption);
+    parser.addOption(workloadsOption);
+    parser.addOption(enginesOption);
+    parser.addOption(repeatOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QStringList sizes = parser.value(sizesOption).split(",", QString::SkipEmptyParts);
+    QStringList workloads = parseList(parser, workloadsOption, Workloads::names());
+    QStringList engines = parseList(parser, enginesOption, Engines::names());
+    int repeat = qMax(parser.value(repeatOption).toInt(), 1);
+
+    QJsonArray results;
+
+    for (int i = 0 ; i < sizes.size() ; i++) {
+        int size = sizes.at(i).toInt();
+
+        for (int j = 0 ; j < workloads.size() ; j++) {
+            Workload workload = Workloads::create(workloads.at(j), size);
+            if (workload.name.isEmpty()) {
+                continue;
+            }
+
+            for (int k = 0 ; k < engines.size() ; k++) {
+                Result result = Engines::run(engines.at(k), workload, repeat);
+                if (result.engine.isEmpty()) {
+                    continue;
+                }
+
+                qInfo().noquote() << QString("%1 %2 %3: compare %4ms apply %5ms signals %6ms")
+                                     .arg(result.engine, result.workload).arg(result.size)
+                                     .arg(result.compareNs / 1e6, 0, 'f', 3)
+                                     .arg(result.applyNs / 1e6, 0, 'f', 3)
+                                     .arg(result.signalNs / 1e6, 0, 'f', 3);
+                results.append(result.toJson());
+            }
+        }
+    }
+
+    QJsonObject report;
+    report["qtVersion"] = QString(qVersion());
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["repeat"] = repeat;
+    report["allocationsCountMalloc"] = Allocations::countsMalloc();
+    report["results"] = results;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "diffbench: Failed to write" << file.fileName();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include <algorithm>
+#include <random>
+#include "workloads.h"
+
+Workload::Workload()
+{
+    keyed = true;
+}
+
+static ImmutableType1 createItem(const QString& id, int value)
+{
+    ImmutableType1 item;
+    item.setId(id);
+    item.setValue(QString::number(value));
+    return item;
+}
+
+static QList<ImmutableType1> createList(int size, int firstId = 0)
+{
+    QList<ImmutableType1> res;
+    res.reserve(size);
+    for (int i = 0 ; i < size ; i++) {
+        res << createItem(QString::number(firstId + i), i);
+    }
+    return res;
+}
+
+// Change the value of every 10th item
+static void updateScattered(QList<ImmutableType1>& list)
+{
+    for (int i = 0 ; i < list.size() ; i += 10) {
+        ImmutableType1 item = list.at(i);
+        item.setValue(item.value() + "*");
+        list[i] = item;
+    }
+}
+
+QStringList Workloads::names()
+{
+    return QStringList() << "append" << "prepend" << "removeFront" << "update" << "moveBlock"
+                         << "reverse" << "shuffle" << "duplicateKeys" << "keyless";
+}
+
+Workload Workloads::create(const QString &name, int size)
+{
+    Workload res;
+    int block = qMax(size / 10, 1);
+
+    res.name = name;
+    res.from = createList(size);
+    res.to = res.from;
+
+    if (name == "append") {
+        res.to.append(createList(block, size));
+    } else if (name == "prepend") {
+        res.to = createList(block, size) + res.from;
+    } else if (name == "removeFront") {
+        res.to = res.from.mid(block);
+    } else if (name == "update") {
+        updateScattered(res.to);
+    } else if (name == "moveBlock") {
+        // Move a block from 10% to 80% of the list
+        QList<ImmutableType1> moving = res.to.mid(block, block);
+        res.to.erase(res.to.begin() + block, res.to.begin() + qMin(2 * block, res.to.size()));
+        int pos = qMin(size * 8 / 10, res.to.size());
+        for (int i = 0 ; i < moving.size() ; i++) {
+            res.to.insert(pos + i, moving.at(i));
+        }
+    } else if (name == "reverse") {
+        std::reverse(res.to.begin(), res.to.end());
+    } else if (name == "shuffle") {
+        std::mt19937 random(size);
+        std::shuffle(res.to.begin(), res.to.end(), random);
+    } else if (name == "duplicateKeys") {
+        // Every key appears twice
+        for (int i = 0 ; i < size ; i++) {
+            res.from[i] = createItem(QString::number(i / 2), i);
+        }
+        res.to = res.from;
+        updateScattered(res.to);
+        res.to.append(createList(block, size));
+    } else if (name == "keyless") {
+        res.keyed = false;
+        updateScattered(res.to);
+        res.to.erase(res.to.begin() + size / 2, res.to.begin() + qMin(size / 2 + block, res.to.size()));
+    } else {
+        qWarning() << "diffbench: Unknown workload" << name;
+        res.name.clear();
+    }
+
+    return res;
+}
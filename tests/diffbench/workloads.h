@@ -0,0 +1,35 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QList>
+#include <QStringList>
+#include "immutabletype1.h"
+
+/// A pair of lists to be compared
+class Workload {
+public:
+    Workload();
+
+    QString name;
+
+    // False if the engines should compare the lists without a key field
+    bool keyed;
+
+    QList<ImmutableType1> from;
+    QList<ImmutableType1> to;
+};
+
+namespace Workloads {
+
+// append, prepend, removeFront, update, moveBlock, reverse, shuffle, duplicateKeys, keyless
+QStringList names();
+
+// Create a workload of the "from" list with size items. The result is the same for every run.
+Workload create(const QString& name, int size);
+
+}
@@ -1,5 +1,11 @@
 #include <QQmlApplicationEngine>
 #include <QTest>
+#include <QSignalSpy>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
 #include <qimmutablevariantlistmodel.h>
 #include "immutabletype1.h"
 #include "immutabletype2.h"
@@ -7,9 +13,17 @@
 #include "priv/qimmutableitem_p.h"
 #include "priv/qimmutablefastdiffrunneralgo_p.h"
 #include "priv/qimmutablecollection.h"
+#include "priv/qsalgotypes_p.h"
 #include "immutabletype3.h"
 #include "qimmutablefastdiffrunner.h"
 #include "qimmutablelistmodel.h"
+#include "qimmutablechunkedlist.h"
+#include "qimmutablesynchub.h"
+#include "qsdiffrunner.h"
+#include "qimmutablereplicator.h"
+#include "qimmutabletrace.h"
+#include "qimmutablecapture.h"
+#include "priv/qimmutableqmllistmodel_p.h"
 
 using namespace QImmutable;
 
@@ -174,6 +188,38 @@ void FastDiffTests::test_compare()
         QVERIFY(QImmutable::fastCompare(v1, v2));
     }
 
+    {
+        // Nested containers
+        QVariantMap child;
+        child["value"] = 1;
+        QVariantList children;
+        children << child << QString("text") << QByteArray("bytes");
+
+        QVariantMap m1, m2;
+        m1["children"] = children;
+        m1["id"] = 1;
+        m2["children"] = children;
+        m2["id"] = 1.0;
+
+        // Shared children, and int / double are converted
+        QVERIFY(QImmutable::fastCompare(m1, m2));
+        QVERIFY(QImmutable::diff(m1, m2).isEmpty());
+
+        // Equal but not shared
+        QVariantMap copy;
+        copy["value"] = 1;
+        m2["children"] = QVariantList() << copy << QString("text") << QByteArray("bytes");
+        QVERIFY(QImmutable::fastCompare(m1, m2));
+
+        copy["value"] = 2;
+        m2["children"] = QVariantList() << copy << QString("text") << QByteArray("bytes");
+        QVERIFY(!QImmutable::fastCompare(m1, m2));
+        QCOMPARE(QImmutable::diff(m1, m2).keys(), QStringList() << "children");
+
+        QVERIFY(QImmutable::fastCompare(QVariant(), QVariant()));
+        QVERIFY(!QImmutable::fastCompare(QVariant(), QVariant(1)));
+    }
+
 }
 
 void FastDiffTests::test_FastDiffRunner()
@@ -444,3 +490,888 @@ void FastDiffTests::test_ListModel_setCustomConvertor()
     QCOMPARE(listModel.get(2)["customValue"].toInt(), 2);
 
 }
+
+void FastDiffTests::test_ChunkedList()
+{
+    QList<ImmutableType1> list;
+    for (int i = 0 ; i < 1000 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        item.setValue(QString::number(i));
+        list << item;
+    }
+
+    ChunkedList<ImmutableType1> previous(list, 16);
+    QCOMPARE(previous.size(), 1000);
+    QCOMPARE(previous.chunkCount(), 63);
+    QCOMPARE(previous.at(500).id(), QString("500"));
+
+    ChunkedList<ImmutableType1> current = previous;
+    QVERIFY(current.isSharedWith(previous));
+
+    ImmutableType1 item = current.at(500);
+    item.setValue("changed");
+    current.replace(500, item);
+
+    // Only the chunk holding the item is detached
+    QCOMPARE(previous.at(500).value(), QString("500"));
+    QVERIFY(current.chunk(0).isSharedWith(previous.chunk(0)));
+    QVERIFY(!current.chunk(31).isSharedWith(previous.chunk(31)));
+    QVERIFY(current.chunk(62).isSharedWith(previous.chunk(62)));
+
+    FastDiffRunner<ImmutableType1> runner;
+    QSPatchSet patches = runner.compare(previous, current);
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches[0].type(), QSPatch::Update);
+    QCOMPARE(patches[0].from(), 500);
+
+    ImmutableType1 inserted;
+    inserted.setId("inserted");
+    current.insert(300, inserted);
+    current.removeAt(700);
+    current.move(10, 900);
+    QCOMPARE(current.size(), 1000);
+
+    patches = runner.compare(previous, current);
+
+    QImmutable::ListModel<ImmutableType1> model;
+    model.setSource(previous.toList());
+    runner.patch(&model, patches);
+
+    QVERIFY(convertList(current.toList()) == model.storage());
+}
+
+void FastDiffTests::test_ListModel_edit()
+{
+    ImmutableType1 a,b,c,d,e;
+    a.setId("a");
+    b.setId("b");
+    c.setId("c");
+    d.setId("d");
+    e.setId("e");
+
+    QList<ImmutableType1> list;
+    list << a << b << c;
+
+    QImmutable::ListModel<ImmutableType1> model;
+    model.setSource(list);
+
+    QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy changeSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    ImmutableType1 c2 = c;
+    c2.setValue("changed");
+
+    model.edit().insert(0, d).removeKey("b").update("c", c2).append(e).commit();
+
+    QList<ImmutableType1> expected;
+    expected << d << a << c2 << e;
+
+    QCOMPARE(insertSpy.count(), 2);
+    QCOMPARE(removeSpy.count(), 1);
+    QCOMPARE(changeSpy.count(), 1);
+
+    QCOMPARE(model.source().size(), expected.size());
+    for (int i = 0 ; i < expected.size() ; i++) {
+        QVERIFY(QImmutable::isShared(model.source().at(i), expected.at(i)));
+    }
+
+    // Same as a full comparison
+    QImmutable::ListModel<ImmutableType1> reference;
+    reference.setSource(list);
+    reference.setSource(expected);
+    QVERIFY(reference.storage() == model.storage());
+    QVERIFY(convertList(expected) == model.storage());
+
+    // Invalid key is ignored
+    model.edit().removeKey("x").commit();
+    QCOMPARE(model.count(), 4);
+
+    // An edit before the end drops the key table, and the next key lookup rebuilds it
+    model.edit().removeKey("d").insert(1, b).commit();
+    model.edit().removeKey("a").update("b", b).removeKey("e").commit();
+    QCOMPARE(model.count(), 2);
+    QVERIFY(QImmutable::isShared(model.source().at(0), b));
+    QVERIFY(QImmutable::isShared(model.source().at(1), c2));
+
+    // The table is kept in sync across transactions with the edits at the end
+    model.edit().append(d).append(e).commit();
+    model.edit().removeKey("e").update("d", d).removeKey("b").commit();
+    QCOMPARE(model.count(), 2);
+    QVERIFY(QImmutable::isShared(model.source().at(0), c2));
+    QVERIFY(QImmutable::isShared(model.source().at(1), d));
+
+    // The table is rebuilt for a new source
+    model.setSource(list);
+    model.edit().removeKey("a").commit();
+    QVERIFY(convertList(QList<ImmutableType1>() << b << c) == model.storage());
+}
+
+void FastDiffTests::test_SyncHub()
+{
+    ImmutableType1 a,b,c,d;
+    a.setId("a");
+    b.setId("b");
+    c.setId("c");
+    d.setId("d");
+    a.setValue("1");
+
+    QList<ImmutableType1> list;
+    list << a << b << c;
+
+    VariantListModel main, minimap, labels;
+
+    SyncHub<ImmutableType1> hub;
+    hub.addSink(&main);
+    hub.addSink(&minimap, QStringList() << "id");
+    hub.setSource(list);
+
+    // Added after the first sync
+    hub.addSink(&labels, [](const ImmutableType1& item, int index) {
+        Q_UNUSED(index);
+        QVariantMap map;
+        map["label"] = item.id() + ":" + item.value();
+        return map;
+    });
+    QCOMPARE(hub.sinkCount(), 3);
+
+    auto verify = [&]() {
+        QList<ImmutableType1> source = hub.source();
+        QVERIFY(main.storage() == convertList(source));
+        QCOMPARE(minimap.count(), source.size());
+        QCOMPARE(labels.count(), source.size());
+
+        for (int i = 0 ; i < source.size() ; i++) {
+            QVariantMap item = minimap.get(i);
+            QCOMPARE(item.size(), 1);
+            QCOMPARE(item["id"].toString(), source[i].id());
+            QCOMPARE(labels.get(i)["label"].toString(), source[i].id() + ":" + source[i].value());
+        }
+    };
+
+    verify();
+
+    a.setValue("2");
+    list.clear();
+    list << c << a << d;
+    hub.setSource(list);
+    verify();
+
+    hub.removeSink(&labels);
+    QCOMPARE(hub.sinkCount(), 2);
+}
+
+void FastDiffTests::test_resumableCompare()
+{
+    QList<ImmutableType1> from, to, other;
+
+    for (int i = 0 ; i < 2000 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        from << item;
+        if (i % 7 != 0) {
+            to.prepend(item);
+        }
+        if (i % 5 != 0) {
+            other << item;
+        }
+    }
+    other.move(10, 1500);
+
+    FastDiffRunner<ImmutableType1> runner;
+    QSPatchSet expected = runner.compare(from, to);
+
+    FastDiffRunnerAlgo<ImmutableType1> algo;
+    algo.start(from, to);
+
+    int turns = 0;
+    while (!algo.run(0)) {
+        turns++;
+    }
+    QVERIFY(turns > 1);
+    QVERIFY(algo.result() == expected);
+
+    // Restart with a newer source in the middle
+    algo.start(from, to);
+    algo.run(0);
+    QVERIFY(!algo.isFinished());
+    algo.start(from, other);
+    QVERIFY(algo.run(-1));
+    QVERIFY(algo.result() == runner.compare(from, other));
+
+    // QmlListModel
+    QQmlApplicationEngine engine;
+
+    auto createArray = [&](const QList<ImmutableType1>& list) {
+        QJSValue array = engine.newArray(list.size());
+        for (int i = 0 ; i < list.size() ; i++) {
+            QJSValue object = engine.newObject();
+            object.setProperty("key", list[i].id());
+            array.setProperty(i, object);
+        }
+        return array;
+    };
+
+    QmlListModel model;
+    model.setKeyField("key");
+    model.setFields(QStringList() << "key");
+    model.setCompareBudget(0);
+
+    QSignalSpy sourceChanged(&model, SIGNAL(sourceChanged()));
+
+    // Append to an empty model is finished immediately
+    model.setSource(createArray(from));
+    QVERIFY(!model.comparing());
+    QCOMPARE(model.count(), from.size());
+
+    model.setSource(createArray(to));
+    QVERIFY(model.comparing());
+    QCOMPARE(model.count(), from.size());
+
+    // A newer source restarts the comparison
+    QCoreApplication::processEvents();
+    model.setSource(createArray(other));
+
+    QTRY_VERIFY(!model.comparing());
+    QCOMPARE(sourceChanged.count(), 2);
+    QCOMPARE(model.count(), other.size());
+    for (int i = 0 ; i < other.size() ; i++) {
+        QCOMPARE(model.get(i)["key"].toString(), other[i].id());
+    }
+}
+
+void FastDiffTests::test_identityKey()
+{
+    QList<ImmutableType2> from, to;
+
+    for (int i = 0 ; i < 100 ; i++) {
+        from << ImmutableType2(QString::number(i));
+    }
+
+    to = from;
+    to.move(10, 80);
+    to.removeAt(0);
+    to.insert(50, ImmutableType2("new"));
+    to[90] = ImmutableType2("modified");
+
+    FastDiffRunner<ImmutableType2> runner;
+
+    // Without a key, every shifted item is updated
+    QSPatchSet patches = runner.compare(from, to);
+    QVERIFY(patches.size() > 50);
+
+    runner.setIdentityKeyEnabled(true);
+    patches = runner.compare(from, to);
+
+    int moves = 0, updates = 0;
+    for (int i = 0 ; i < patches.size() ; i++) {
+        if (patches[i].type() == QSPatch::Move) {
+            moves++;
+        } else if (patches[i].type() == QSPatch::Update) {
+            updates++;
+        }
+    }
+    QVERIFY(moves > 0);
+    QCOMPARE(updates, 0);
+    QVERIFY(patches.size() < 10);
+
+    VariantListModel listModel;
+    listModel.setStorage(convertList(from));
+    runner.patch(&listModel, patches);
+    QVERIFY(listModel.storage() == convertList(to));
+
+    // Duplicated items fall back to the key-less comparison
+    to = from;
+    to.move(10, 80);
+    to << from[0];
+
+    patches = runner.compare(from, to);
+    listModel.setStorage(convertList(from));
+    runner.patch(&listModel, patches);
+    QVERIFY(listModel.storage() == convertList(to));
+
+    // ListModel
+    ListModel<ImmutableType2> model;
+    model.setIdentityKeyEnabled(true);
+    model.setSource(from);
+
+    QSignalSpy moved(&model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy changed(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    to = from;
+    to.move(10, 80);
+    model.setSource(to);
+    QCOMPARE(moved.count(), 1);
+    QCOMPARE(changed.count(), 0);
+}
+
+void FastDiffTests::test_denseKey()
+{
+    // The same changes on dense keys and sparse keys should produce the same patches
+    auto createList = [](const QList<int>& keys, int scale) {
+        QList<ImmutableType3> res;
+        for (int i = 0 ; i < keys.size() ; i++) {
+            ImmutableType3 item;
+            item.setValue(keys[i] * scale);
+            res << item;
+        }
+        return res;
+    };
+
+    auto createVariantList = [](const QList<int>& keys, int scale) {
+        QVariantList res;
+        for (int i = 0 ; i < keys.size() ; i++) {
+            QVariantMap item;
+            item["id"] = keys[i] * scale;
+            item["value"] = keys[i] % 7;
+            res << item;
+        }
+        return res;
+    };
+
+    auto sameShape = [](const QSPatchSet& a, const QSPatchSet& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (int i = 0 ; i < a.size() ; i++) {
+            if (a[i].type() != b[i].type() || a[i].from() != b[i].from() ||
+                a[i].to() != b[i].to() || a[i].count() != b[i].count()) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    QList<int> fromKeys, toKeys;
+    for (int i = 0 ; i < 1000 ; i++) {
+        fromKeys << i + 10;
+        if (i % 11 != 0) {
+            toKeys << i + 10;
+        }
+    }
+    toKeys.move(5, 700);
+    toKeys.move(900, 3);
+    toKeys.insert(400, 1500);
+    toKeys.insert(20, 5);
+
+    FastDiffRunner<ImmutableType3> runner;
+    QList<ImmutableType3> from = createList(fromKeys, 1);
+    QList<ImmutableType3> to = createList(toKeys, 1);
+    QSPatchSet dense = runner.compare(from, to);
+    QSPatchSet sparse = runner.compare(createList(fromKeys, 100000), createList(toKeys, 100000));
+
+    QVERIFY(dense.size() > 0);
+    QVERIFY(sameShape(dense, sparse));
+
+    VariantListModel listModel;
+    listModel.setStorage(convertList(from));
+    runner.patch(&listModel, dense);
+    QVERIFY(listModel.storage() == convertList(to));
+
+    // QSDiffRunner with an integer keyField
+    QSDiffRunner variantRunner;
+    variantRunner.setKeyField("id");
+
+    QVariantList fromList = createVariantList(fromKeys, 1);
+    QVariantList toList = createVariantList(toKeys, 1);
+    dense = variantRunner.compare(fromList, toList);
+    sparse = variantRunner.compare(createVariantList(fromKeys, 100000), createVariantList(toKeys, 100000));
+
+    QVERIFY(sameShape(dense, sparse));
+
+    listModel.setStorage(fromList);
+    variantRunner.patch(&listModel, dense);
+    QVERIFY(listModel.storage() == toList);
+
+    // Keys from JSON are doubles. Integral doubles and 64-bit integers take the dense table too.
+    int key = 0;
+    QVERIFY(QSAlgoTypes::toIntKey(QVariant(3.0), key) && key == 3);
+    QVERIFY(!QSAlgoTypes::toIntKey(QVariant(1.5), key));
+    QVERIFY(!QSAlgoTypes::toIntKey(QVariant(1e12), key));
+    QVERIFY(QSAlgoTypes::toIntKey(QVariant((qlonglong) -5), key) && key == -5);
+    QVERIFY(!QSAlgoTypes::toIntKey(QVariant((qlonglong) 1 << 40), key));
+    QVERIFY(!QSAlgoTypes::toIntKey(QVariant("3"), key));
+
+    auto toDoubleKeys = [](QVariantList list) {
+        for (int i = 0 ; i < list.size() ; i++) {
+            QVariantMap item = list[i].toMap();
+            item["id"] = item["id"].toDouble();
+            list[i] = item;
+        }
+        return list;
+    };
+
+    DiffStatistics intStatistics, doubleStatistics;
+    variantRunner.setStatistics(&intStatistics);
+    variantRunner.compare(fromList, toList);
+    variantRunner.setStatistics(&doubleStatistics);
+    QSPatchSet doublePatches = variantRunner.compare(toDoubleKeys(fromList), toDoubleKeys(toList));
+    variantRunner.setStatistics(0);
+
+    // The dense table reads every key once
+    QCOMPARE(doubleStatistics.keyCalls, intStatistics.keyCalls);
+    QVERIFY(sameShape(doublePatches, dense));
+
+    // Sparse keys stop collecting the int keys at once, so they are not read a third time
+    DiffStatistics sparseStatistics;
+    QList<ImmutableType3> sparseFrom = createList(fromKeys, 100000);
+    QList<ImmutableType3> sparseTo = createList(toKeys, 100000);
+    FastDiffRunnerAlgo<ImmutableType3> sparseAlgo;
+    sparseAlgo.statistics = &sparseStatistics;
+    sparseAlgo.compare(sparseFrom, sparseTo);
+    QVERIFY(sparseStatistics.keyCalls <= 2 * (sparseFrom.size() + sparseTo.size()) + 2);
+}
+
+void FastDiffTests::test_reuseAlgo()
+{
+    QList<ImmutableType1> from, to, other;
+
+    for (int i = 0 ; i < 500 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        from << item;
+        if (i % 3 != 0) {
+            to.prepend(item);
+        }
+    }
+    other = to;
+    other.move(10, 200);
+    other.removeAt(50);
+
+    QList<ImmutableType3> denseFrom, denseTo;
+    for (int i = 0 ; i < 500 ; i++) {
+        ImmutableType3 item;
+        item.setValue(i);
+        denseFrom << item;
+    }
+    denseTo = denseFrom;
+    denseTo.move(0, 300);
+
+    // A reused algo produces the same result as a fresh one
+    FastDiffRunnerAlgo<ImmutableType1> algo;
+    for (int round = 0 ; round < 3 ; round++) {
+        QVERIFY(algo.compare(from, to) == FastDiffRunnerAlgo<ImmutableType1>().compare(from, to));
+        QVERIFY(algo.compare(to, other) == FastDiffRunnerAlgo<ImmutableType1>().compare(to, other));
+        QVERIFY(algo.compare(other, from) == FastDiffRunnerAlgo<ImmutableType1>().compare(other, from));
+        algo.reset();
+    }
+
+    FastDiffRunnerAlgo<ImmutableType3> denseAlgo;
+    for (int round = 0 ; round < 3 ; round++) {
+        QVERIFY(denseAlgo.compare(denseFrom, denseTo) == FastDiffRunnerAlgo<ImmutableType3>().compare(denseFrom, denseTo));
+        QVERIFY(denseAlgo.compare(denseTo, denseFrom) == FastDiffRunnerAlgo<ImmutableType3>().compare(denseTo, denseFrom));
+    }
+
+    // ListModel keeps its algo across syncs
+    ListModel<ImmutableType1> model;
+    QList<QList<ImmutableType1>> sources;
+    sources << from << to << other << from << QList<ImmutableType1>() << other;
+
+    for (int i = 0 ; i < sources.size() ; i++) {
+        model.setSource(sources[i]);
+        QVERIFY(model.storage() == convertList(sources[i]));
+    }
+}
+
+void FastDiffTests::test_sink()
+{
+    QList<ImmutableType1> from, to;
+
+    for (int i = 0 ; i < 300 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        item.setValue(QString::number(i));
+        from << item;
+    }
+
+    to = from;
+    to.move(5, 200);
+    to.move(100, 3);
+    to.removeAt(50);
+    to.removeAt(50);
+    to[20].setValue("changed");
+    to[150].setValue("changed");
+    for (int i = 0 ; i < 3 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString("new%1").arg(i));
+        to.insert(80, item);
+    }
+
+    VariantListModel listModel;
+    Patchable* patchable = &listModel;
+
+    // Keyed
+    FastDiffRunnerAlgo<ImmutableType1> algo;
+    algo.sink = patchable;
+    listModel.setStorage(convertList(from));
+    QVERIFY(algo.compare(from, to).isEmpty());
+    QVERIFY(listModel.storage() == convertList(to));
+
+    // Append / remove from end
+    QList<ImmutableType1> longer = to + from.mid(0, 10);
+    algo.compare(to, longer);
+    QVERIFY(listModel.storage() == convertList(longer));
+    algo.compare(longer, to);
+    QVERIFY(listModel.storage() == convertList(to));
+
+    // Key-less
+    QList<ImmutableType2> keylessFrom, keylessTo;
+    for (int i = 0 ; i < 10 ; i++) {
+        keylessFrom << ImmutableType2(QString::number(i));
+    }
+    keylessTo = keylessFrom.mid(2, 5);
+    keylessTo << ImmutableType2("a") << ImmutableType2("b");
+
+    FastDiffRunnerAlgo<ImmutableType2> keylessAlgo;
+    keylessAlgo.sink = patchable;
+    listModel.setStorage(convertList(keylessFrom));
+    keylessAlgo.compare(keylessFrom, keylessTo);
+    QVERIFY(listModel.storage() == convertList(keylessTo));
+
+    // ChunkedList with shared chunks
+    ChunkedList<ImmutableType1> chunkedFrom(from, 16);
+    ChunkedList<ImmutableType1> chunkedTo = chunkedFrom;
+    ImmutableType1 item = chunkedTo.at(100);
+    item.setValue("changed");
+    chunkedTo.replace(100, item);
+    chunkedTo.move(120, 90);
+
+    listModel.setStorage(convertList(chunkedFrom.toList()));
+    algo.compare(chunkedFrom, chunkedTo);
+    QVERIFY(listModel.storage() == convertList(chunkedTo.toList()));
+
+    // ListModel
+    ListModel<ImmutableType1> model;
+    QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    model.setSource(from);
+    QCOMPARE(inserted.count(), 1);
+    model.setSource(to);
+    QVERIFY(model.storage() == convertList(to));
+}
+
+void FastDiffTests::test_resetStrategy()
+{
+    QList<ImmutableType1> from, reversed, moved, movedToFront, movedToBack;
+
+    for (int i = 0 ; i < 200 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        from << item;
+        reversed.prepend(item);
+    }
+    moved = from;
+    moved.move(10, 150);
+    movedToFront = from;
+    movedToFront.move(199, 0);
+    movedToBack = from;
+    movedToBack.move(0, 199);
+
+    FastDiffRunnerAlgo<ImmutableType1> algo;
+    QSPatchSet patches = algo.compare(from, reversed);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+    QVERIFY(patches.size() > 1);
+
+    // A reverse exceeds the threshold
+    algo.resetRatio = 0.5;
+    patches = algo.compare(from, reversed);
+    QCOMPARE(algo.strategy(), ResetDiff);
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches[0].type(), QSPatch::Reset);
+    QCOMPARE(patches[0].count(), from.size());
+    QVERIFY(patches[0].data() == convertList(reversed));
+
+    // A single move does not
+    patches = algo.compare(from, moved);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches[0].type(), QSPatch::Move);
+
+    patches = algo.compare(from, movedToFront);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches[0].type(), QSPatch::Move);
+
+    patches = algo.compare(from, movedToBack);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches[0].type(), QSPatch::Move);
+
+    // The head chunk is changed but the tail chunk is shared. Only the
+    // middle part is compared so it must not be reset.
+    ChunkedList<ImmutableType1> chunkedFrom(from, 150);
+    ChunkedList<ImmutableType1> chunkedTo = chunkedFrom;
+    for (int i = 0 ; i < 150 ; i++) {
+        chunkedTo.replace(i, reversed.at(i + 50));
+    }
+    QVERIFY(!chunkedTo.chunk(0).isSharedWith(chunkedFrom.chunk(0)));
+    QVERIFY(chunkedTo.chunk(1).isSharedWith(chunkedFrom.chunk(1)));
+
+    patches = algo.compare(chunkedFrom, chunkedTo);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+    for (int i = 0 ; i < patches.size() ; i++) {
+        QVERIFY(patches[i].type() != QSPatch::Reset);
+    }
+
+    Replicator chunkedReplicator;
+    chunkedReplicator.setStorage(convertList(chunkedFrom.toList()));
+    applyPatches(&chunkedReplicator, patches);
+    QVERIFY(chunkedReplicator.storage() == convertList(chunkedTo.toList()));
+
+    // Too small to be reset
+    algo.resetMinimumSize = 1000;
+    algo.compare(from, reversed);
+    QCOMPARE(algo.strategy(), KeyedDiff);
+
+    // Key-less
+    QList<ImmutableType2> keylessFrom, keylessTo;
+    for (int i = 0 ; i < 200 ; i++) {
+        keylessFrom << ImmutableType2(QString::number(i));
+        keylessTo << ImmutableType2(QString::number(i + 1000));
+    }
+
+    FastDiffRunnerAlgo<ImmutableType2> keylessAlgo;
+    keylessAlgo.resetRatio = 0.5;
+    keylessAlgo.compare(keylessFrom, keylessFrom.mid(0, 190));
+    QCOMPARE(keylessAlgo.strategy(), KeylessDiff);
+    patches = keylessAlgo.compare(keylessFrom, keylessTo);
+    QCOMPARE(keylessAlgo.strategy(), ResetDiff);
+    QCOMPARE(patches.size(), 1);
+
+    // The model receives a single reset
+    ListModel<ImmutableType1> model;
+    model.setResetThreshold(0.5);
+    model.setSource(from);
+
+    QSignalSpy reset(&model, SIGNAL(modelReset()));
+    QSignalSpy movedRows(&model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    model.setSource(reversed);
+    QCOMPARE(model.lastStrategy(), ResetDiff);
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(movedRows.count(), 0);
+    QVERIFY(model.storage() == convertList(reversed));
+
+    model.setSource(moved);
+    QCOMPARE(model.lastStrategy(), KeyedDiff);
+    QCOMPARE(reset.count(), 1);
+    QVERIFY(model.storage() == convertList(moved));
+
+    // A Patchable without reset() receives a removal and an insertion
+    Replicator replicator;
+    replicator.setStorage(convertList(from));
+    applyPatch(&replicator, QSPatch(QSPatch::Reset, 0, from.size() - 1, from.size(), convertList(reversed)));
+    QVERIFY(replicator.storage() == convertList(reversed));
+}
+
+void FastDiffTests::test_diffStatistics()
+{
+    QList<ImmutableType1> from, to;
+
+    for (int i = 0 ; i < 100 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        item.setValue(QString::number(i));
+        from << item;
+    }
+
+    to = from;
+    to.move(10, 50);
+    to.removeAt(80);
+    to[20].setValue("changed");
+
+    DiffStatistics statistics;
+    FastDiffRunnerAlgo<ImmutableType1> algo;
+    algo.statistics = &statistics;
+    QSPatchSet patches = algo.compare(from, to);
+
+    QCOMPARE(statistics.fromCount, 100);
+    QCOMPARE(statistics.toCount, 99);
+    QCOMPARE(statistics.skipped, 10);
+    QCOMPARE(statistics.movePatches, 1);
+    QCOMPARE(statistics.removePatches, 1);
+    QCOMPARE(statistics.updatePatches, 1);
+    QCOMPARE(statistics.insertPatches + statistics.movePatches + statistics.removePatches + statistics.updatePatches, patches.size());
+    QVERIFY(statistics.keyCalls > 0);
+    QVERIFY(statistics.hashProbes > 0);
+    QVERIFY(statistics.converterCalls > 0);
+    QVERIFY(statistics.totalTime >= statistics.hashBuildTime);
+    QVERIFY(!statistics.appendToEnd);
+    QVERIFY(!statistics.sharedList);
+
+    // Fast paths
+    algo.compare(from, from + to.mid(0, 5));
+    QVERIFY(statistics.appendToEnd);
+    QCOMPARE(statistics.insertPatches, 1);
+    algo.compare(from, from.mid(0, 50));
+    QVERIFY(statistics.removeFromEnd);
+    algo.compare(from, from);
+    QVERIFY(statistics.sharedList);
+    QCOMPARE(statistics.hashProbes, 0);
+
+    // QSDiffRunner
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+    runner.setStatistics(&statistics);
+    patches = runner.compare(convertList(from), convertList(to));
+    QCOMPARE(statistics.fromCount, 100);
+    QCOMPARE(statistics.skipped, 10);
+    QCOMPARE(statistics.movePatches, 1);
+    QCOMPARE(statistics.removePatches, 1);
+    QCOMPARE(statistics.updatePatches, 1);
+    QVERIFY(statistics.hashProbes > 0);
+
+    // ListModel
+    ListModel<ImmutableType1> model;
+    QSignalSpy spy(&model, SIGNAL(diffStatisticsChanged()));
+    model.setSource(from);
+    QCOMPARE(spy.count(), 0);
+
+    model.setDiffStatisticsEnabled(true);
+    model.setSource(to);
+    QCOMPARE(spy.count(), 1);
+
+    QVariantMap map = model.property("diffStatistics").toMap();
+    QCOMPARE(map["fromCount"].toInt(), 100);
+    QCOMPARE(map["movePatches"].toInt(), 1);
+    QVERIFY(map.contains("applyTime"));
+    QVERIFY(model.lastDiffStatistics().applyTime > 0);
+}
+
+void FastDiffTests::test_trace()
+{
+    QList<ImmutableType1> from, to;
+
+    for (int i = 0 ; i < 100 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        from << item;
+    }
+    to = from;
+    to.move(10, 50);
+
+    auto names = []() {
+        QStringList res;
+        QJsonObject trace = QJsonDocument::fromJson(Trace::toJson()).object();
+        QJsonArray events = trace["traceEvents"].toArray();
+        for (int i = 0 ; i < events.size() ; i++) {
+            QJsonObject event = events.at(i).toObject();
+            if (event["ph"].toString() == "X" && event["dur"].toDouble() >= 0) {
+                res << event["name"].toString();
+            }
+        }
+        return res;
+    };
+
+    Trace::clear();
+    QVERIFY(!Trace::isEnabled());
+
+    ListModel<ImmutableType1> model;
+    model.setSource(from);
+    QVERIFY(names().isEmpty());
+
+    QLoggingCategory::setFilterRules("qimmutable.trace.debug=true");
+    QVERIFY(Trace::isEnabled());
+
+    model.setSource(to);
+    QStringList recorded = names();
+    QVERIFY(recorded.contains("ListModel::setSource"));
+    QVERIFY(recorded.contains("FastDiffRunnerAlgo::run"));
+    QVERIFY(recorded.contains("FastDiffRunnerAlgo::hashBuild"));
+    QVERIFY(recorded.contains("FastDiffRunnerAlgo::walk"));
+    QVERIFY(recorded.contains("applyPatches"));
+    QVERIFY(recorded.contains("VariantListModel::batch"));
+
+    // The converter calls are reported on the phase spans instead of a span per item
+    Trace::clear();
+    ImmutableType1 extra;
+    extra.setId("extra");
+    model.setSource(QList<ImmutableType1>() << extra << to);
+    QVERIFY(!names().contains("FastDiffRunnerAlgo::convert"));
+
+    int converterCalls = 0;
+    QJsonArray events = QJsonDocument::fromJson(Trace::toJson()).object()["traceEvents"].toArray();
+    for (int i = 0 ; i < events.size() ; i++) {
+        QJsonObject args = events.at(i).toObject()["args"].toObject();
+        converterCalls += args["converterCalls"].toInt();
+    }
+    QCOMPARE(converterCalls, 1);
+
+    // The oldest spans are dropped
+    Trace::setCapacity(2);
+    model.setSource(from);
+    QCOMPARE(names().size(), 2);
+    QCOMPARE(names().last(), QString("ListModel::setSource"));
+
+    QLoggingCategory::setFilterRules("qimmutable.trace.debug=false");
+    Trace::setCapacity(100000);
+    model.setSource(to);
+    QVERIFY(names().isEmpty());
+}
+
+void FastDiffTests::test_capture()
+{
+    QTemporaryDir dir;
+    QString fileName = dir.path() + "/model.capture";
+
+    QList<ImmutableType1> from, to;
+    for (int i = 0 ; i < 10 ; i++) {
+        ImmutableType1 item;
+        item.setId(QString::number(i));
+        item.setValue(QString("value%1").arg(i));
+        from << item;
+    }
+    to = from;
+    to.move(2, 8);
+    to.removeAt(0);
+
+    ListModel<ImmutableType1> model;
+    QSignalSpy spy(&model, SIGNAL(captureFileChanged()));
+
+    model.setSource(from);
+    model.setCaptureFile(fileName);
+    QCOMPARE(model.captureFile(), fileName);
+    QCOMPARE(spy.count(), 1);
+
+    model.setSource(from);
+    model.setSource(to);
+
+    // A transaction is recorded and reported like a sync
+    QList<ImmutableType1> edited = to;
+    edited.removeAt(0);
+    model.setDiffStatisticsEnabled(true);
+    model.edit().remove(0).commit();
+    QCOMPARE(model.diffStatistics()["fromCount"].toInt(), to.size());
+    QCOMPARE(model.diffStatistics()["toCount"].toInt(), edited.size());
+    QCOMPARE(model.diffStatistics()["removePatches"].toInt(), 1);
+
+    model.setSource(QList<ImmutableType1>());
+
+    model.setCaptureFile(QString());
+    QVERIFY(model.captureFile().isEmpty());
+    model.setSource(from);
+
+    QList<CaptureFrame> frames = CaptureReader::load(fileName);
+    QCOMPARE(frames.size(), 4);
+    QCOMPARE(frames[0].source, convertList(from));
+    QCOMPARE(frames[1].source, convertList(to));
+    QCOMPARE(frames[2].source, convertList(edited));
+    QCOMPARE(frames[3].source, QVariantList());
+    QVERIFY(frames[0].timestamp <= frames[1].timestamp);
+
+    // Replay the frames
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+    VariantListModel replayed;
+    for (int i = 0 ; i < frames.size() ; i++) {
+        QSPatchSet patches = runner.compare(replayed.storage(), frames[i].source);
+        runner.patch(&replayed, patches);
+        QCOMPARE(replayed.storage(), frames[i].source);
+    }
+
+    // Not a capture file
+    QFile file(dir.path() + "/invalid.capture");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("invalid");
+    file.close();
+    QVERIFY(CaptureReader::load(file.fileName()).isEmpty());
+}
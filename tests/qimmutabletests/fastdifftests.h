@@ -25,6 +25,30 @@ private slots:
     void test_FastDiffRunner_QJSValue();
 
     void test_ListModel_setCustomConvertor();
+
+    void test_ChunkedList();
+
+    void test_ListModel_edit();
+
+    void test_SyncHub();
+
+    void test_resumableCompare();
+
+    void test_identityKey();
+
+    void test_denseKey();
+
+    void test_reuseAlgo();
+
+    void test_sink();
+
+    void test_resetStrategy();
+
+    void test_diffStatistics();
+
+    void test_trace();
+
+    void test_capture();
 };
 
 #endif // FASTDIFTESTS_H
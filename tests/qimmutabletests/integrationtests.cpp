@@ -1,4 +1,8 @@
 #include <QTest>
+#include <QTemporaryDir>
+#include <QSignalSpy>
+#include <QBuffer>
+#include <thread>
 #include <QSListModel>
 #include <QSortFilterProxyModel>
 #include <QSDiffRunner>
@@ -8,9 +12,26 @@
 #include "automator.h"
 #include "integrationtests.h"
 #include "qimmutablefunctions.h"
+#include "qimmutableaggregator.h"
+#include "qimmutablesnapshot.h"
+#include "qimmutablejournal.h"
+#include "qimmutablereplicator.h"
+#include "qimmutableincrementalpatcher.h"
 
 using namespace QImmutable;
 
+// An item of the tests on a keyed list. The group is only set if it is given.
+static QVariantMap createItem(const QString& id, int value, const QString& group = QString())
+{
+    QVariantMap map;
+    map["id"] = id;
+    if (!group.isNull()) {
+        map["group"] = group;
+    }
+    map["value"] = value;
+    return map;
+}
+
 IntegrationTests::IntegrationTests(QObject *parent) : QObject(parent)
 {
 
@@ -307,3 +328,389 @@ void IntegrationTests::test_omit()
 }
 
 
+
+void IntegrationTests::test_Aggregator()
+{
+    // Recompute the expected result from the storage
+    auto verify = [](const QVariantList& storage, Aggregator& aggregator) {
+        QMap<QString, int> counts;
+        QMap<QString, int> sums;
+        QMap<QString, int> sections;
+
+        for (int i = 0 ; i < storage.size() ; i++) {
+            QVariantMap item = storage.at(i).toMap();
+            QString group = item["group"].toString();
+            counts[group]++;
+            sums[group] += item["value"].toInt();
+            if (i == 0 || storage.at(i - 1).toMap()["group"].toString() != group) {
+                sections[group]++;
+            }
+        }
+
+        QCOMPARE(aggregator.count(), storage.size());
+
+        VariantListModel* groups = qobject_cast<VariantListModel*>(aggregator.groups());
+        QVERIFY(groups);
+        QCOMPARE(groups->count(), counts.size());
+
+        // Every row of the groups model is written to the row of its group
+        QVariantList rows = groups->storage();
+        for (int i = 0 ; i < rows.size() ; i++) {
+            QVariantMap row = rows.at(i).toMap();
+            QCOMPARE(row["count"].toInt(), counts[row["group"].toString()]);
+            QCOMPARE(row["sections"].toInt(), sections[row["group"].toString()]);
+        }
+
+        int total = 0;
+        foreach (QString group, counts.keys()) {
+            QVariantMap result = aggregator.group(group);
+            QCOMPARE(result["count"].toInt(), counts[group]);
+            QCOMPARE(result["sum"].toInt(), sums[group]);
+            QCOMPARE(result["sections"].toInt(), sections[group]);
+            total += sections[group];
+        }
+        QCOMPARE(aggregator.sectionCount(), total);
+    };
+
+    VariantListModel listModel;
+    Aggregator aggregator;
+    aggregator.setGroupField("group");
+    aggregator.setValueField("value");
+
+    QVariantList list;
+    list << createItem("a", 1, "x") << createItem("b", 2, "x") << createItem("c", 3, "y") << createItem("d", 4, "z");
+
+    listModel.setStorage(list);
+    aggregator.reset(list);
+    verify(listModel.storage(), aggregator);
+    QCOMPARE(aggregator.group("x")["min"].toInt(), 1);
+    QCOMPARE(aggregator.group("x")["max"].toInt(), 2);
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+
+    auto sync = [&](const QVariantList& current) {
+        QSPatchSet patches = runner.compare(listModel.storage(), current);
+        runner.patch(&listModel, patches);
+        runner.patch(&aggregator, patches);
+        QVERIFY(listModel.storage() == current);
+    };
+
+    // Insert, Move, Update and Remove
+    list.clear();
+    list << createItem("c", 3, "y") << createItem("a", 1, "x") << createItem("e", 5, "x") << createItem("b", 2, "z") << createItem("d", 7, "z");
+    sync(list);
+    verify(listModel.storage(), aggregator);
+    QCOMPARE(aggregator.group("x")["max"].toInt(), 5);
+
+    list.clear();
+    list << createItem("d", 7, "z") << createItem("a", 1, "y");
+    sync(list);
+    verify(listModel.storage(), aggregator);
+    QVERIFY(aggregator.group("x").isEmpty());
+    QCOMPARE(aggregator.sectionCount(), 2);
+}
+
+void IntegrationTests::test_Snapshot()
+{
+    VariantListModel listModel;
+    QVERIFY(listModel.snapshot().isNull());
+
+    QVariantList list;
+    list << createItem("a", 1) << createItem("b", 2) << createItem("c", 3);
+    listModel.setStorage(list);
+
+    listModel.setSnapshotEnabled(true);
+    Snapshot first = listModel.snapshot();
+    QVERIFY(!first.isNull());
+    QCOMPARE(first.storage(), list);
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+
+    QVariantList next;
+    next << createItem("c", 3) << createItem("a", 10) << createItem("d", 4);
+    runner.patch(&listModel, runner.compare(list, next));
+
+    // Published on the next event loop turn, as a single version
+    QCOMPARE(listModel.snapshot().version(), first.version());
+    QTRY_COMPARE(listModel.snapshot().version(), first.version() + 1);
+
+    Snapshot second = listModel.snapshot();
+    QCOMPARE(second.storage(), next);
+
+    // The previous snapshot is not affected
+    QCOMPARE(first.storage(), list);
+
+    // Read from another thread
+    int sum = 0;
+    std::thread reader([&]() {
+        Snapshot snapshot = listModel.snapshot();
+        for (int i = 0 ; i < snapshot.count() ; i++) {
+            sum += snapshot.get(i)["value"].toInt();
+        }
+    });
+    reader.join();
+    QCOMPARE(sum, 17);
+
+    VariantListModel replica;
+    replica.setStorage(first.storage());
+    runner.patch(&replica, first.diff(second, "id"));
+    QCOMPARE(replica.storage(), second.storage());
+
+    listModel.setSnapshotEnabled(false);
+    QVERIFY(listModel.snapshot().isNull());
+}
+
+void IntegrationTests::test_Journal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.path() + "/model";
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+
+    VariantListModel listModel;
+    QVariantList list;
+
+    auto sync = [&](Journal& journal, const QVariantList& next) {
+        QSPatchSet patches = runner.compare(listModel.storage(), next);
+        runner.patch(&listModel, patches);
+        journal.append(patches);
+    };
+
+    {
+        Journal journal;
+        journal.setPath(path);
+        QVERIFY(journal.load().isEmpty());
+        QVERIFY(journal.open());
+        QCOMPARE(journal.generation(), 0);
+
+        list << createItem("a", 1) << createItem("b", 2) << createItem("c", 3);
+        sync(journal, list);
+
+        list.move(0, 2);
+        list[1] = createItem("c", 30);
+        sync(journal, list);
+    }
+
+    {
+        Journal journal;
+        journal.setPath(path);
+        QCOMPARE(journal.load(), list);
+        QVERIFY(journal.open());
+
+        qint64 size = journal.journalSize();
+        journal.compact(listModel.storage());
+        QCOMPARE(journal.generation(), 1);
+        QVERIFY(journal.journalSize() < size);
+
+        // Changes made during compaction go to the new journal
+        list.removeAt(0);
+        list << createItem("d", 4);
+        sync(journal, list);
+
+        journal.waitForCompaction();
+        QVERIFY(!journal.compacting());
+        QVERIFY(!QFile::exists(path + ".journal.0"));
+    }
+
+    // Appended by a Patchable call, then an incomplete record is left on crash
+    {
+        Journal journal;
+        journal.setPath(path);
+        QCOMPARE(journal.load(), list);
+        QVERIFY(journal.open());
+
+        list << createItem("e", 5);
+        runner.patch(&journal, runner.compare(listModel.storage(), list));
+        journal.close();
+
+        QFile file(path + ".journal.1");
+        QVERIFY(file.open(QIODevice::Append));
+        file.write(QByteArray("\x00\x00\x10\x00\x01", 5));
+        file.close();
+    }
+
+    {
+        Journal journal;
+        journal.setPath(path);
+        QCOMPARE(journal.load(), list);
+        QVERIFY(journal.open());
+
+        // The incomplete record is truncated, so new records remain readable
+        list << createItem("f", 6);
+        journal.set(list.size() - 1, createItem("f", 6));
+        journal.close();
+
+        QCOMPARE(journal.load(), list);
+    }
+}
+
+void IntegrationTests::test_Replicator()
+{
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+
+    QVariantList list;
+    list << createItem("a", 1) << createItem("b", 2) << createItem("c", 3);
+
+    QByteArray bytes;
+    QBuffer output(&bytes);
+    output.open(QIODevice::WriteOnly);
+
+    Replicator replicator;
+    replicator.setStorage(list);
+    replicator.setDevice(&output);
+
+    QVariantList next;
+    next << createItem("c", 3) << createItem("a", 10) << createItem("d", 4);
+    replicator.send(runner.compare(list, next));
+
+    // Applied through the Patchable interface and sent on the next event loop turn
+    QVariantList last = next;
+    last.removeAt(0);
+    runner.patch(&replicator, runner.compare(next, last));
+    QCOMPARE(replicator.storage(), last);
+    QCoreApplication::processEvents();
+
+    // Deliver the stream in two parts to simulate a partial read
+    QBuffer input;
+    input.open(QIODevice::ReadWrite);
+    input.write(bytes.left(bytes.size() / 2));
+    input.seek(0);
+
+    Replica replica;
+    QSignalSpy spy(&replica, SIGNAL(synced()));
+    replica.setDevice(&input);
+
+    qint64 pos = input.pos();
+    input.seek(input.size());
+    input.write(bytes.mid(bytes.size() / 2));
+    input.seek(pos);
+    replica.read();
+
+    QCOMPARE(spy.count(), 3);
+    VariantListModel* model = qobject_cast<VariantListModel*>(replica.model());
+    QCOMPARE(model->storage(), last);
+    QVERIFY(!replica.desynced());
+
+    // A corrupted message followed by a valid patch set
+    QByteArray corrupted;
+    QBuffer corruptedOutput(&corrupted);
+    corruptedOutput.open(QIODevice::WriteOnly);
+
+    Replicator source;
+    source.setStorage(list);
+    source.setDevice(&corruptedOutput);
+    int snapshotSize = corrupted.size();
+    source.send(runner.compare(list, next));
+    source.send(runner.compare(next, last));
+
+    QVERIFY((quint8) corrupted.at(snapshotSize) < 0x80);
+    corrupted[snapshotSize + 1] = (char) 0xff;
+
+    QBuffer corruptedInput(&corrupted);
+    corruptedInput.open(QIODevice::ReadWrite);
+    int corruptedSize = corrupted.size();
+
+    Replica desyncedReplica;
+    QSignalSpy desyncedSynced(&desyncedReplica, SIGNAL(synced()));
+    QSignalSpy desyncedChanged(&desyncedReplica, SIGNAL(desyncedChanged()));
+    desyncedReplica.setDevice(&corruptedInput);
+
+    // The patch set after the corrupted message is dropped
+    VariantListModel* desyncedModel = qobject_cast<VariantListModel*>(desyncedReplica.model());
+    QVERIFY(desyncedReplica.desynced());
+    QCOMPARE(desyncedChanged.count(), 1);
+    QCOMPARE(desyncedSynced.count(), 1);
+    QCOMPARE(desyncedModel->storage(), list);
+
+    // A resync request is written back
+    QByteArray request = corrupted.mid(corruptedSize);
+    QCOMPARE(request.size(), 2);
+
+    // The Replicator answers the request with a snapshot
+    QByteArray reply;
+    QBuffer replyChannel(&reply);
+    replyChannel.open(QIODevice::ReadWrite);
+    source.setDevice(&replyChannel);
+
+    qint64 replyPos = replyChannel.pos();
+    replyChannel.write(request);
+    replyChannel.seek(replyPos);
+    QCoreApplication::processEvents();
+    QVERIFY(reply.size() > replyPos + request.size());
+
+    qint64 pos = corruptedInput.pos();
+    corruptedInput.write(reply.mid(replyPos + request.size()));
+    corruptedInput.seek(pos);
+    desyncedReplica.read();
+
+    QVERIFY(!desyncedReplica.desynced());
+    QCOMPARE(desyncedChanged.count(), 2);
+    QCOMPARE(desyncedSynced.count(), 2);
+    QCOMPARE(desyncedModel->storage(), last);
+}
+
+void IntegrationTests::test_IncrementalPatcher()
+{
+    QVariantList from, to;
+
+    for (int i = 0 ; i < 1000 ; i++) {
+        QVariantMap map;
+        map["id"] = i;
+        map["value"] = i;
+        from << map;
+        if (i % 3 != 0) {
+            map["value"] = -i;
+            to << map;
+        }
+    }
+    to.move(0, to.size() - 1);
+
+    for (int i = 1000 ; i < 2000 ; i++) {
+        QVariantMap map;
+        map["id"] = i;
+        map["value"] = i;
+        to.insert(100, map);
+    }
+
+    VariantListModel listModel;
+    listModel.setStorage(from);
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+    QSPatchSet patches = runner.compare(from, to);
+
+    IncrementalPatcher patcher;
+    patcher.setBudget(0);
+    patcher.setChunkSize(100);
+
+    QSignalSpy finished(&patcher, SIGNAL(finished()));
+    QSignalSpy rowsInserted(&listModel, SIGNAL(rowsInserted(QModelIndex,int,int)));
+
+    patcher.patch(&listModel, patches);
+    QVERIFY(patcher.syncing());
+    QVERIFY(patcher.pendingCount() > patches.size() - 1);
+    QCOMPARE(listModel.storage(), from);
+
+    // One step per turn with zero budget
+    int pending = patcher.pendingCount();
+    QCoreApplication::processEvents();
+    QCOMPARE(patcher.pendingCount(), pending - 1);
+
+    QTRY_VERIFY(!patcher.syncing());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(listModel.storage(), to);
+
+    // The insertion of 1000 rows is split by chunkSize
+    QVERIFY(rowsInserted.count() >= 10);
+
+    // finish() applies the rest immediately
+    patcher.patch(&listModel, runner.compare(to, from));
+    patcher.finish();
+    QCOMPARE(finished.count(), 2);
+    QCOMPARE(listModel.storage(), from);
+}
@@ -28,6 +28,16 @@ private slots:
 
     void test_omit();
 
+    void test_Aggregator();
+
+    void test_Snapshot();
+
+    void test_Journal();
+
+    void test_Replicator();
+
+    void test_IncrementalPatcher();
+
 };
 
 #endif // INTEGRATIONTESTS_H
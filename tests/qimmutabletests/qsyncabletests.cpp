@@ -1,5 +1,6 @@
 #include <QVariantList>
 #include <QTest>
+#include <QSignalSpy>
 #include <QSDiffRunner>
 #include <QSListModel>
 #include "qsyncabletests.h"
@@ -9,6 +10,9 @@
 #include "qimmutablelistmodel.h"
 #include "qimmutablefunctions.h"
 #include "immutabletype2.h"
+#include "qimmutablecompose.h"
+#include "qimmutablepatchcodec.h"
+#include "qsjsonlistmodel.h"
 
 using namespace QImmutable;
 
@@ -269,6 +273,164 @@ void QSyncableTests::patch_merge()
 
 }
 
+void QSyncableTests::patch_compose()
+{
+    QFETCH(QString, from);
+    QFETCH(QString, middle);
+    QFETCH(QString, to);
+    QFETCH(int, expectedSize);
+
+    QVariantList fList = convert(from.split(",", QString::SkipEmptyParts));
+    QVariantList mList = convert(middle.split(",", QString::SkipEmptyParts));
+    QVariantList tList = convert(to.split(",", QString::SkipEmptyParts));
+
+    // Update an item on the second step
+    if (tList.size() > 0) {
+        QVariantMap item = tList[0].toMap();
+        item["value"] = "changed";
+        tList[0] = item;
+    }
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+
+    QSPatchSet first = runner.compare(fList, mList);
+    QSPatchSet second = runner.compare(mList, tList);
+
+    QSPatchSet patches = QImmutable::compose(fList.size(), first, second);
+
+    VariantListModel listModel;
+    listModel.setStorage(fList);
+    runner.patch(&listModel, patches);
+
+    QString message;
+    QDebug(&message) << "first" << first << "second" << second << "composed" << patches
+                     << "actual" << convert(listModel.storage()).join(",");
+    QVERIFY2(listModel.storage() == tList, qPrintable(message));
+
+    if (expectedSize >= 0) {
+        QCOMPARE(patches.size(), expectedSize);
+    }
+}
+
+void QSyncableTests::patch_compose_data()
+{
+    QTest::addColumn<QString>("from");
+    QTest::addColumn<QString>("middle");
+    QTest::addColumn<QString>("to");
+    QTest::addColumn<int>("expectedSize");
+
+    // Inserted then removed. Only the update remains
+    QTest::newRow("Cancel insert") << "a,b,c" << "a,x,b,c" << "a,b,c" << 1;
+
+    // Moved then moved back
+    QTest::newRow("Cancel move") << "a,b,c,d" << "d,a,b,c" << "a,b,c,d" << 1;
+
+    QTest::newRow("Chain moves") << "a,b,c,d,e" << "b,a,c,d,e" << "b,c,d,e,a" << -1;
+
+    QTest::newRow("Insert and remove") << "a,b,c" << "x,a,b,c" << "x,a,c,y" << -1;
+
+    QTest::newRow("Remove all") << "a,b,c" << "b,c" << "" << 1;
+}
+
+void QSyncableTests::patch_codec()
+{
+    QVariantList from = convert(QString("a,b,c,d,e").split(","));
+    QVariantList to = convert(QString("e,a,f,c,b").split(","));
+
+    QVariantMap item = to[1].toMap();
+    item["value"] = 3.5;
+    item["flag"] = true;
+    item["count"] = -42;
+    item["tags"] = QVariantList() << "x" << 1;
+    item["date"] = QDate(2016, 1, 1);
+    to[1] = item;
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+    QSPatchSet patches = runner.compare(from, to);
+
+    PatchEncoder encoder;
+    PatchDecoder decoder;
+    QSPatchSet decoded;
+    QVariantList storage;
+
+    QCOMPARE(decoder.decode(encoder.encodeSnapshot(from), decoded, storage), PatchDecoder::Snapshot);
+    QVERIFY(storage == from);
+
+    QByteArray message = encoder.encode(patches);
+    QCOMPARE(decoder.decode(message, decoded, storage), PatchDecoder::Patches);
+    QVERIFY(decoded == patches);
+
+    // Role names are only written on their first use
+    QByteArray repeated = encoder.encode(patches);
+    QVERIFY(repeated.size() < message.size());
+    QCOMPARE(decoder.decode(repeated, decoded, storage), PatchDecoder::Patches);
+    QVERIFY(decoded == patches);
+
+    QCOMPARE(decoder.decode(message.left(message.size() / 2), decoded, storage), PatchDecoder::Invalid);
+
+    // Doubles are written in little endian on any host
+    QVariantMap number;
+    number["value"] = 1.0;
+    QByteArray snapshot = PatchEncoder().encodeSnapshot(QVariantList() << number);
+    QVERIFY(snapshot.contains(QByteArray::fromHex("000000000000f03f")));
+    QCOMPARE(PatchDecoder().decode(snapshot, decoded, storage), PatchDecoder::Snapshot);
+    QVERIFY(storage == (QVariantList() << number));
+}
+
+void QSyncableTests::patch_move()
+{
+    QVariantList items;
+    for (int i = 0 ; i < 5 ; i++) {
+        QVariantMap item;
+        item["id"] = QString::number(i);
+        items << item;
+    }
+
+    // The payload is handed over without a copy
+    QVariantList payload = items;
+    QSPatch patch(QSPatch::Insert, 0, 4, 5, std::move(payload));
+    QVERIFY(patch.data().isSharedWith(items));
+
+    QSPatch moved = std::move(patch);
+    QVERIFY(moved.data().isSharedWith(items));
+
+    QVariantList taken = moved.takeData();
+    QVERIFY(taken.isSharedWith(items));
+    QVERIFY(moved.data().isEmpty());
+
+    // The inserted items are shared with the payload
+    VariantListModel model;
+    QSPatchSet patches;
+    patches << QSPatch(QSPatch::Insert, 0, 4, 5, items);
+    QSDiffRunner runner;
+    runner.patch(&model, std::move(patches));
+    QCOMPARE(model.count(), 5);
+    QVERIFY(model.storage().at(2).toMap().isSharedWith(items.at(2).toMap()));
+
+    // An update doesn't detach the other fields of an item
+    QVariantMap item = items.at(2).toMap();
+    item["value"] = 1;
+    runner.patch(&model, QSPatchSet() << QSPatch::createUpdate(2, item));
+    QCOMPARE(model.get(2)["value"].toInt(), 1);
+    QCOMPARE(model.get(2)["id"].toString(), QString("2"));
+
+    // ListModel takes over the source
+    QList<ImmutableType1> source;
+    for (int i = 0 ; i < 5 ; i++) {
+        ImmutableType1 value;
+        value.setId(QString::number(i));
+        source << value;
+    }
+    QList<ImmutableType1> copy = source;
+
+    ListModel<ImmutableType1> listModel;
+    listModel.setSource(std::move(source));
+    QVERIFY(listModel.source().isSharedWith(copy));
+    QCOMPARE(listModel.count(), 5);
+}
+
 void QSyncableTests::tree()
 {
     Tree tree;
@@ -729,6 +891,97 @@ void QSyncableTests::diffRunner_randomMove()
 
 }
 
+void QSyncableTests::diffRunner_nested()
+{
+    auto createColumn = [](const QString& uuid, const QVariantList& cards) {
+        QVariantMap map;
+        map["uuid"] = uuid;
+        map["cards"] = cards;
+        return map;
+    };
+
+    QVariantList cards;
+    for (int i = 0 ; i < 500 ; i++) {
+        QVariantMap card;
+        card["uuid"] = QString("card-%1").arg(i);
+        card["text"] = QString("Card %1").arg(i);
+        cards << card;
+    }
+
+    QVariantList movedCards = cards;
+    movedCards.move(10, 400);
+
+    QVariantList from, to;
+    from << createColumn("a", cards) << createColumn("b", QVariantList());
+    to << createColumn("a", movedCards) << createColumn("b", QVariantList() << cards.at(0));
+
+    QSDiffRunner runner;
+    runner.setKeyField("uuid");
+
+    // Without nested key field, the whole list is replaced
+    QSPatchSet patches = runner.compare(from, to);
+    QCOMPARE(patches.size(), 2);
+    QCOMPARE(patches[0].data()[0].toMap()["cards"].toList().size(), 500);
+
+    runner.setNestedKeyField("cards", "uuid");
+    patches = runner.compare(from, to);
+    QCOMPARE(patches.size(), 2);
+
+    QSPatchSet nested = patches[0].data()[0].toMap()["cards"].value<QSPatchSet>();
+    QCOMPARE(nested.size(), 1);
+    QCOMPARE(nested[0].type(), QSPatch::Move);
+
+    VariantListModel listModel;
+    listModel.setStorage(from);
+    QSignalSpy spy(&listModel, SIGNAL(nestedPatchApplied(int,QString,QSPatchSet)));
+
+    runner.patch(&listModel, patches);
+    QVERIFY(listModel.storage() == to);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy[0][0].toInt(), 0);
+    QCOMPARE(spy[0][1].toString(), QString("cards"));
+
+    // A JsonListModel following the field receives the sub-patches
+    listModel.setStorage(from);
+
+    QSJsonListModel child;
+    static_cast<QQmlParserStatus*>(&child)->classBegin();
+    child.setKeyField("uuid");
+    child.setParentModel(&listModel);
+    child.setParentIndex(0);
+    child.setParentField("cards");
+    static_cast<QQmlParserStatus*>(&child)->componentComplete();
+    QVERIFY(child.storage() == cards);
+
+    QSignalSpy childMoved(&child, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy childInserted(&child, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy childRemoved(&child, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+
+    runner.patch(&listModel, patches);
+    QVERIFY(child.storage() == movedCards);
+    QVERIFY(child.source() == movedCards);
+    QCOMPARE(childMoved.count(), 1);
+    QCOMPARE(childInserted.count(), 0);
+    QCOMPARE(childRemoved.count(), 0);
+
+    // A replaced list is compared
+    child.setParentIndex(1);
+    QVERIFY(child.storage() == (QVariantList() << cards.at(0)));
+
+    // Composed sub-patches are chained
+    QVariantList last = to;
+    QVariantMap column = last[0].toMap();
+    QVariantList lastCards = column["cards"].toList();
+    lastCards.removeAt(0);
+    column["cards"] = lastCards;
+    last[0] = column;
+
+    QSPatchSet composed = QImmutable::compose(from.size(), patches, runner.compare(to, last));
+    listModel.setStorage(from);
+    runner.patch(&listModel, composed);
+    QVERIFY(listModel.storage() == last);
+}
+
 void QSyncableTests::diffRunner_complex()
 {
     QFETCH(QStringList, from);
@@ -846,3 +1099,78 @@ void QSyncableTests::listModel_roleNames()
     delete model;
 }
 
+void QSyncableTests::listModel_batch()
+{
+    class Recorder : public BatchPatchable {
+    public:
+        void beginBatch() { log << "begin"; }
+        void endBatch() { log << "end"; }
+        void insert(int index, const QVariantList &value) { log << QString("insert %1 %2").arg(index).arg(value.size()); }
+        void insert(int index, QVariantList &&value) { log << QString("insert&& %1 %2").arg(index).arg(value.size()); }
+        void move(int from, int to, int count) { log << QString("move %1 %2 %3").arg(from).arg(to).arg(count); }
+        void remove(int i, int count) { log << QString("remove %1 %2").arg(i).arg(count); }
+        void set(int index, QVariantMap dict) { Q_UNUSED(dict); log << QString("set %1").arg(index); }
+        void setRange(int first, int last, QVector<QVariantMap> changes) {
+            Q_UNUSED(changes);
+            log << QString("setRange %1 %2").arg(first).arg(last);
+        }
+        QStringList log;
+    };
+
+    QVariantList from, to;
+    for (int i = 0 ; i < 10 ; i++) {
+        QVariantMap item;
+        item["id"] = QString::number(i);
+        item["value"] = i;
+        from << item;
+    }
+
+    to = from;
+    to.removeAt(0);
+    for (int i = 2 ; i < 5 ; i++) {
+        QVariantMap item = to[i].toMap();
+        item["value"] = -i;
+        to[i] = item;
+    }
+    QVariantMap item;
+    item["id"] = "new";
+    to << item;
+
+    QSDiffRunner runner;
+    runner.setKeyField("id");
+    QSPatchSet patches = runner.compare(from, to);
+
+    Recorder recorder;
+    runner.patch(&recorder, patches);
+    QCOMPARE(recorder.log.first(), QString("begin"));
+    QCOMPARE(recorder.log.last(), QString("end"));
+    QVERIFY(recorder.log.contains("setRange 2 4"));
+    QVERIFY(recorder.log.contains("insert&& 9 1"));
+
+    // VariantListModel
+    VariantListModel model;
+    model.setStorage(from);
+
+    QSignalSpy countChanged(&model, SIGNAL(countChanged()));
+    QSignalSpy dataChanged(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    runner.patch(&model, patches);
+    QVERIFY(model.storage() == to);
+    QCOMPARE(countChanged.count(), 1);
+    QCOMPARE(dataChanged.count(), 1);
+    QCOMPARE(dataChanged[0][0].value<QModelIndex>().row(), 2);
+    QCOMPARE(dataChanged[0][1].value<QModelIndex>().row(), 4);
+
+    // Moved payloads are inserted at the right position
+    BatchPatchable* batch = &model;
+    QVariantList items;
+    items << item << item;
+    batch->insert(3, std::move(items));
+    QCOMPARE(model.count(), to.size() + 2);
+    QCOMPARE(model.get(3)["id"].toString(), QString("new"));
+    QCOMPARE(model.get(4)["id"].toString(), QString("new"));
+    QCOMPARE(model.get(5)["id"].toString(), to[3].toMap()["id"].toString());
+
+    QVERIFY(batch->reset(QVariantList() << item));
+    QCOMPARE(model.count(), 1);
+}
@@ -17,6 +17,13 @@ private slots:
     void patch();
     void patch_merge();
 
+    void patch_compose();
+    void patch_compose_data();
+
+    void patch_codec();
+
+    void patch_move();
+
     void tree();
     void tree_insert();
     void tree_remove();
@@ -40,9 +47,13 @@ private slots:
     void diffRunner_complex();
     void diffRunner_complex_data();
 
+    void diffRunner_nested();
+
 //    void listModel_insert();
     void listModel_roleNames();
 
+    void listModel_batch();
+
 };
 
 #endif // QSYNCABLETESTS_H
@@ -0,0 +1,204 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include <QJSEngine>
+#include "qimmutablecapture.h"
+#include "qsdiffrunner.h"
+#include "qimmutablevariantlistmodel.h"
+#include "priv/qimmutablefastdiffrunneralgo_p.h"
+#include "priv/qimmutableqmllistmodel_p.h"
+
+using namespace QImmutable;
+
+// Options shared by the engines
+class Config {
+public:
+    QString keyField;
+    qreal resetRatio;
+};
+
+static QList<QVariantMap> toMapList(const QVariantList& list)
+{
+    QList<QVariantMap> res;
+    res.reserve(list.size());
+    for (int i = 0 ; i < list.size() ; i++) {
+        res << list.at(i).toMap();
+    }
+    return res;
+}
+
+// Compare every pair of frames and apply the patches to a model holding the previous frame
+template <typename CompareFunc>
+static QJsonArray replay(const QList<CaptureFrame>& frames, VariantListModel* model, CompareFunc compare)
+{
+    QJsonArray res;
+
+    for (int i = 0 ; i < frames.size() ; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        QSPatchSet patches = compare(i);
+        qint64 compareNs = timer.nsecsElapsed();
+
+        int count = patches.size();
+        timer.restart();
+        applyPatches(model, std::move(patches));
+        qint64 applyNs = timer.nsecsElapsed();
+
+        QJsonObject step;
+        step["step"] = i;
+        step["timestamp"] = (double) frames.at(i).timestamp;
+        step["size"] = frames.at(i).source.size();
+        step["compareNs"] = (double) compareNs;
+        step["applyNs"] = (double) applyNs;
+        step["patches"] = count;
+        res.append(step);
+    }
+
+    return res;
+}
+
+static QJsonArray runQSDiffRunner(const QList<CaptureFrame>& frames, const Config& config)
+{
+    QSDiffRunner runner;
+    runner.setKeyField(config.keyField);
+
+    VariantListModel model;
+    return replay(frames, &model, [&](int i) {
+        return runner.compare(i > 0 ? frames.at(i - 1).source : QVariantList(), frames.at(i).source);
+    });
+}
+
+static QJsonArray runFastDiffRunner(const QList<CaptureFrame>& frames, const Config& config)
+{
+    QList<QList<QVariantMap> > lists;
+    for (int i = 0 ; i < frames.size() ; i++) {
+        lists << toMapList(frames.at(i).source);
+    }
+
+    Item<QVariantMap> wrapper;
+    wrapper.keyField = config.keyField;
+
+    VariantListModel model;
+    return replay(frames, &model, [&](int i) {
+        FastDiffRunnerAlgo<QVariantMap> algo;
+        algo.setWrapper(wrapper);
+        algo.resetRatio = config.resetRatio;
+        return algo.compare(i > 0 ? lists.at(i - 1) : QList<QVariantMap>(), lists.at(i));
+    });
+}
+
+// The same comparison as QmlListModel::setSource()
+static QJsonArray runQmlListModel(const QList<CaptureFrame>& frames, const Config& config)
+{
+    QJSEngine engine;
+    QList<QJSValue> values;
+    for (int i = 0 ; i < frames.size() ; i++) {
+        values << engine.toScriptValue(frames.at(i).source);
+    }
+
+    Item<QJSValue> wrapper;
+    wrapper.keyField = config.keyField;
+
+    FastDiffRunnerAlgo<QJSValue> algo;
+    algo.setWrapper(wrapper);
+    algo.resetRatio = config.resetRatio;
+
+    QmlListModel model;
+    return replay(frames, &model, [&](int i) {
+        QSPatchSet res = algo.compare(i > 0 ? values.at(i - 1) : engine.newArray(), values.at(i));
+        algo.reset();
+        return res;
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList engineNames;
+    engineNames << "qsdiffrunner" << "fastdiffrunner" << "qmllistmodel";
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a file captured by the captureFile property of a model, "
+                                     "and report the compare and apply cost of every step as JSON.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "The capture file.");
+
+    QCommandLineOption engineOption("engine", "The engine: " + engineNames.join(","), "engine", "fastdiffrunner");
+    QCommandLineOption keyFieldOption("key-field", "The key field. Empty for a list without key.", "field", "id");
+    QCommandLineOption resetOption("reset-threshold", "The reset threshold ratio. A negative value disables it.", "ratio", "-1");
+    QCommandLineOption outputOption("output", "Write the result to a file instead of stdout.", "file");
+
+    parser.addOption(engineOption);
+    parser.addOption(keyFieldOption);
+    parser.addOption(resetOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    QString fileName = parser.positionalArguments().first();
+    QList<CaptureFrame> frames = CaptureReader::load(fileName);
+
+    if (frames.isEmpty()) {
+        qWarning() << "replay: No frame is read from" << fileName;
+        return 1;
+    }
+
+    Config config;
+    config.resetRatio = parser.value(resetOption).toDouble();
+
+    // The engines compare without key only if the key field is a null string
+    QString keyField = parser.value(keyFieldOption);
+    config.keyField = keyField.isEmpty() ? QString() : keyField;
+
+    QString engine = parser.value(engineOption);
+    QJsonArray steps;
+
+    if (engine == "qsdiffrunner") {
+        steps = runQSDiffRunner(frames, config);
+    } else if (engine == "fastdiffrunner") {
+        steps = runFastDiffRunner(frames, config);
+    } else if (engine == "qmllistmodel") {
+        steps = runQmlListModel(frames, config);
+    } else {
+        qWarning() << "replay: Unknown engine" << engine;
+        return 1;
+    }
+
+    double compareNs = 0, applyNs = 0;
+    for (int i = 0 ; i < steps.size() ; i++) {
+        compareNs += steps.at(i).toObject()["compareNs"].toDouble();
+        applyNs += steps.at(i).toObject()["applyNs"].toDouble();
+    }
+
+    QJsonObject report;
+    report["capture"] = fileName;
+    report["engine"] = engine;
+    report["keyField"] = config.keyField;
+    report["resetThreshold"] = config.resetRatio;
+    report["qtVersion"] = QString(qVersion());
+    report["totalCompareNs"] = compareNs;
+    report["totalApplyNs"] = applyNs;
+    report["steps"] = steps;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "replay: Failed to write" << file.fileName();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+QT       += qml
+QT       -= gui
+
+TARGET = replay
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp
+
+include(../../qimmutable.pri)
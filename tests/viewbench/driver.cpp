@@ -0,0 +1,162 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include <QtQuick>
+#include <algorithm>
+#include "driver.h"
+#include "qimmutablelistmodel.h"
+
+using namespace QImmutable;
+
+static QVariantList toVariantList(const QList<ImmutableType1>& list)
+{
+    QVariantList res;
+    res.reserve(list.size());
+    for (int i = 0 ; i < list.size() ; i++) {
+        res << QImmutable::convert(list.at(i));
+    }
+    return res;
+}
+
+Driver::Driver(const QString &model, QObject *parent) : QObject(parent), m_model(model)
+{
+    m_delegates = 0;
+    m_signals = 0;
+}
+
+QString Driver::model() const
+{
+    return m_model;
+}
+
+QVariantList Driver::source() const
+{
+    return m_source;
+}
+
+void Driver::countDelegate()
+{
+    m_delegates++;
+}
+
+QStringList Driver::models()
+{
+    return QStringList() << "listmodel" << "immutablelistmodel" << "jsonlistmodel";
+}
+
+QJsonObject Driver::run(const Workload &workload, int steps)
+{
+    QJsonObject res;
+
+    ListModel<ImmutableType1> listModel;
+    listModel.setRoleNames(QStringList() << "id" << "value");
+
+    QQuickView view;
+    view.rootContext()->setContextProperty("driver", this);
+    view.rootContext()->setContextProperty("listModel", &listModel);
+    view.setSource(QUrl("qrc:/main.qml"));
+
+    if (view.status() != QQuickView::Ready) {
+        qWarning() << "viewbench: Failed to load main.qml" << view.errors();
+        return res;
+    }
+
+    QAbstractItemModel* target = &listModel;
+    if (m_model != "listmodel") {
+        target = view.rootObject()->findChild<QAbstractItemModel*>(m_model);
+    }
+
+    auto count = [this]() {
+        m_signals++;
+    };
+    connect(target, &QAbstractItemModel::rowsInserted, this, count);
+    connect(target, &QAbstractItemModel::rowsRemoved, this, count);
+    connect(target, &QAbstractItemModel::rowsMoved, this, count);
+    connect(target, &QAbstractItemModel::dataChanged, this, count);
+    connect(target, &QAbstractItemModel::modelReset, this, count);
+
+    QVariantList variantFrom, variantTo;
+    if (m_model != "listmodel") {
+        variantFrom = toVariantList(workload.from);
+        variantTo = toVariantList(workload.to);
+    }
+
+    auto apply = [&](bool forward) {
+        if (m_model == "listmodel") {
+            listModel.setSource(forward ? workload.to : workload.from);
+        } else {
+            m_source = forward ? variantTo : variantFrom;
+            emit sourceChanged();
+        }
+    };
+
+    view.show();
+    apply(false);
+    waitForFrame(&view);
+
+    m_delegates = 0;
+    m_signals = 0;
+
+    QVector<double> applyTimes;
+    QVector<double> frameTimes;
+    int timeouts = 0;
+
+    for (int i = 0 ; i < steps ; i++) {
+        QElapsedTimer timer;
+        timer.start();
+
+        apply(i % 2 == 0);
+        applyTimes << timer.nsecsElapsed() / 1e6;
+
+        // The time until the change is presented: the signals, delegate creation, bindings, layout and rendering
+        if (!waitForFrame(&view)) {
+            timeouts++;
+        }
+        frameTimes << timer.nsecsElapsed() / 1e6;
+    }
+
+    auto mean = [](const QVector<double>& values) {
+        double sum = 0;
+        for (int i = 0 ; i < values.size() ; i++) {
+            sum += values.at(i);
+        }
+        return values.isEmpty() ? 0 : sum / values.size();
+    };
+
+    QVector<double> sortedFrames = frameTimes;
+    std::sort(sortedFrames.begin(), sortedFrames.end());
+
+    res["model"] = m_model;
+    res["workload"] = workload.name;
+    res["size"] = workload.from.size();
+    res["steps"] = steps;
+    res["applyMs"] = mean(applyTimes);
+    res["frameMs"] = mean(frameTimes);
+    res["medianFrameMs"] = sortedFrames.isEmpty() ? 0 : sortedFrames.at(sortedFrames.size() / 2);
+    res["maxFrameMs"] = sortedFrames.isEmpty() ? 0 : sortedFrames.last();
+    res["delegatesCreated"] = m_delegates;
+    res["signals"] = m_signals;
+    res["timeouts"] = timeouts;
+
+    return res;
+}
+
+bool Driver::waitForFrame(QQuickWindow *window)
+{
+    QEventLoop loop;
+    bool swapped = false;
+
+    connect(window, &QQuickWindow::frameSwapped, &loop, [&]() {
+        swapped = true;
+        loop.quit();
+    }, Qt::QueuedConnection);
+    QTimer::singleShot(2000, &loop, SLOT(quit()));
+
+    window->update();
+    loop.exec();
+
+    return swapped;
+}
@@ -0,0 +1,50 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QJsonObject>
+#include <QVariantList>
+#include "workloads.h"
+
+class QQuickWindow;
+
+/// Feeds a workload to a model behind a ListView, and measures the frames
+class Driver : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString model READ model CONSTANT)
+    Q_PROPERTY(QVariantList source READ source NOTIFY sourceChanged)
+
+public:
+    // model: listmodel, immutablelistmodel or jsonlistmodel
+    explicit Driver(const QString& model, QObject *parent = 0);
+
+    QString model() const;
+
+    QVariantList source() const;
+
+    // The lists of the workload are set alternately, so every step has the same changes
+    QJsonObject run(const Workload& workload, int steps);
+
+    Q_INVOKABLE void countDelegate();
+
+    static QStringList models();
+
+signals:
+    void sourceChanged();
+
+private:
+    // Wait until a frame is presented. Returns false if it is timed out.
+    bool waitForFrame(QQuickWindow* window);
+
+    QString m_model;
+    QVariantList m_source;
+
+    int m_delegates;
+    int m_signals;
+};
@@ -0,0 +1,106 @@
+/* QImmutable Project
+   Author: Ben Lau
+   License: Apache-2.0
+   Web: https://github.com/e-fever/qimmutable
+*/
+#include <QtCore>
+#include <QGuiApplication>
+#include "driver.h"
+#include "workloads.h"
+
+static QStringList parseList(const QCommandLineParser& parser, const QCommandLineOption& option, const QStringList& all)
+{
+    QString value = parser.value(option);
+    if (value.isEmpty()) {
+        return all;
+    }
+    return value.split(",", QString::SkipEmptyParts);
+}
+
+int main(int argc, char* argv[])
+{
+    // Run without a display unless the platform is chosen explicitly
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    if (!qEnvironmentVariableIsSet("QT_QUICK_BACKEND")) {
+        qputenv("QT_QUICK_BACKEND", "software");
+    }
+    qputenv("QML_DISABLE_DISK_CACHE", "1");
+
+    QGuiApplication app(argc, argv);
+
+    QStringList workloadNames;
+    workloadNames << "append" << "prepend" << "removeFront" << "update" << "moveBlock" << "reverse" << "shuffle";
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure the frame time of a ListView while its model is synced. "
+                                     "The result is written as JSON.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma separated list sizes.", "sizes", "1000,10000");
+    QCommandLineOption workloadsOption("workloads", "Comma separated workloads: " + workloadNames.join(","), "workloads");
+    QCommandLineOption modelsOption("models", "Comma separated models: " + Driver::models().join(","), "models");
+    QCommandLineOption stepsOption("steps", "No. of syncs per case.", "steps", "20");
+    QCommandLineOption outputOption("output", "Write the result to a file instead of stdout.", "file");
+
+    parser.addOption(sizesOption);
+    parser.addOption(workloadsOption);
+    parser.addOption(modelsOption);
+    parser.addOption(stepsOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QStringList sizes = parser.value(sizesOption).split(",", QString::SkipEmptyParts);
+    QStringList workloads = parseList(parser, workloadsOption, workloadNames);
+    QStringList models = parseList(parser, modelsOption, Driver::models());
+    int steps = qMax(parser.value(stepsOption).toInt(), 1);
+
+    QJsonArray results;
+
+    for (int i = 0 ; i < sizes.size() ; i++) {
+        for (int j = 0 ; j < workloads.size() ; j++) {
+            Workload workload = Workloads::create(workloads.at(j), sizes.at(i).toInt());
+            if (workload.name.isEmpty() || !workload.keyed) {
+                continue;
+            }
+
+            for (int k = 0 ; k < models.size() ; k++) {
+                Driver driver(models.at(k));
+                QJsonObject result = driver.run(workload, steps);
+                if (result.isEmpty()) {
+                    continue;
+                }
+
+                qInfo().noquote() << QString("%1 %2 %3: apply %4ms frame %5ms delegates %6 signals %7")
+                                     .arg(models.at(k), workload.name).arg(workload.from.size())
+                                     .arg(result["applyMs"].toDouble(), 0, 'f', 3)
+                                     .arg(result["frameMs"].toDouble(), 0, 'f', 3)
+                                     .arg(result["delegatesCreated"].toInt())
+                                     .arg(result["signals"].toInt());
+                results.append(result);
+            }
+        }
+    }
+
+    QJsonObject report;
+    report["qtVersion"] = QString(qVersion());
+    report["platform"] = QGuiApplication::platformName();
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["results"] = results;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "viewbench: Failed to write" << file.fileName();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+import QtQuick 2.0
+import QImmutable 1.0
+import QSyncable 1.0
+
+Item {
+    width: 480
+    height: 800
+
+    ImmutableListModel {
+        id: immutableListModel
+        objectName: "immutablelistmodel"
+        keyField: "id"
+        fields: ["id", "value"]
+        source: driver.model === "immutablelistmodel" ? driver.source : []
+    }
+
+    JsonListModel {
+        id: jsonListModel
+        objectName: "jsonlistmodel"
+        keyField: "id"
+        fields: ["id", "value"]
+        source: driver.model === "jsonlistmodel" ? driver.source : []
+    }
+
+    ListView {
+        id: listView
+        anchors.fill: parent
+        model: driver.model === "listmodel" ? listModel :
+               driver.model === "immutablelistmodel" ? immutableListModel : jsonListModel
+
+        delegate: Rectangle {
+            width: ListView.view.width
+            height: 40
+            color: index % 2 ? "#eeeeee" : "#ffffff"
+
+            Column {
+                anchors.fill: parent
+                anchors.margins: 4
+
+                Text {
+                    text: model.id
+                    font.bold: true
+                }
+
+                Text {
+                    text: model.value
+                    elide: Text.ElideRight
+                    width: parent.width
+                }
+            }
+
+            Component.onCompleted: driver.countDelegate();
+        }
+    }
+}
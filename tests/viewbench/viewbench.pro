@@ -0,0 +1,25 @@
+QT       += qml quick
+
+TARGET = viewbench
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../diffbench ../qimmutabletests
+
+SOURCES += \
+    main.cpp \
+    driver.cpp \
+    ../diffbench/workloads.cpp \
+    ../qimmutabletests/immutabletype1.cpp
+
+HEADERS += \
+    driver.h \
+    ../diffbench/workloads.h \
+    ../qimmutabletests/immutabletype1.h
+
+RESOURCES += \
+    viewbench.qrc
+
+include(../../qimmutable.pri)